@@ -0,0 +1,29 @@
+// Generated by command_table_generator from CommandList.h, do not edit
+
+#define COMMAND_TABLE_SIZE			64
+#define COMMAND_NAME_MIN_LENGTH		3
+#define COMMAND_NAME_MAX_LENGTH		7
+
+// Multipliers of the second and last characters
+#define COMMAND_HASH_SECOND_CHAR	28
+#define COMMAND_HASH_LAST_CHAR		58
+
+// Indexed by hash
+static const CommandId slots[COMMAND_TABLE_SIZE] = {
+	COMMAND_UNKNOWN, COMMAND_USER, COMMAND_CAP, COMMAND_KILL,
+	COMMAND_UNKNOWN, COMMAND_UNKNOWN, COMMAND_UNKNOWN, COMMAND_UNKNOWN,
+	COMMAND_UNKNOWN, COMMAND_KICK, COMMAND_WHOIS, COMMAND_WHOWAS,
+	COMMAND_NICK, COMMAND_UNKNOWN, COMMAND_PONG, COMMAND_UNKNOWN,
+	COMMAND_UNKNOWN, COMMAND_UNKNOWN, COMMAND_UNKNOWN, COMMAND_UNKNOWN,
+	COMMAND_LIST, COMMAND_VERSION, COMMAND_STATS, COMMAND_MODE,
+	COMMAND_UNKNOWN, COMMAND_UNKNOWN, COMMAND_NOTICE, COMMAND_UNKNOWN,
+	COMMAND_UNKNOWN, COMMAND_MOTD, COMMAND_JOIN, COMMAND_UNKNOWN,
+	COMMAND_WHO, COMMAND_UNKNOWN, COMMAND_ADMIN, COMMAND_UNKNOWN,
+	COMMAND_UNKNOWN, COMMAND_PRIVMSG, COMMAND_PING, COMMAND_OPER,
+	COMMAND_UNKNOWN, COMMAND_QUIT, COMMAND_UNKNOWN, COMMAND_TOPIC,
+	COMMAND_LUSERS, COMMAND_UNKNOWN, COMMAND_UNKNOWN, COMMAND_UNKNOWN,
+	COMMAND_UNKNOWN, COMMAND_UNKNOWN, COMMAND_UNKNOWN, COMMAND_AWAY,
+	COMMAND_UNKNOWN, COMMAND_UNKNOWN, COMMAND_TIME, COMMAND_UNKNOWN,
+	COMMAND_PART, COMMAND_INVITE, COMMAND_UNKNOWN, COMMAND_INFO,
+	COMMAND_UNKNOWN, COMMAND_NAMES, COMMAND_PASS, COMMAND_UNKNOWN,
+};
@@ -0,0 +1,135 @@
+//
+// Created by nathan on 4/10/23.
+//
+
+#include <vector>
+#include <string>
+#include "Benchmark.h"
+#include "Casemapping.h"
+#include "Hostmask.h"
+#include "MaskList.h"
+#include "User.h"
+
+// The glob that used to be run on every entry: interpreted, backtracking to the last '*'
+static bool interpreted_glob_match(const StringView& mask, const StringView& name)
+{
+	std::size_t mask_index = 0;
+	std::size_t name_index = 0;
+	std::size_t star_index = static_cast<std::size_t>(-1);
+	std::size_t star_name_index = 0;
+
+	while (name_index < name.size()) {
+		if (mask_index < mask.size() && mask[mask_index] == '*') {
+			star_index = mask_index++;
+			star_name_index = name_index;
+		} else if (mask_index < mask.size()
+			&& (mask[mask_index] == '?' || Casemapping::fold(mask[mask_index]) == Casemapping::fold(name[name_index]))) {
+			mask_index++;
+			name_index++;
+		} else if (star_index != static_cast<std::size_t>(-1)) {
+			mask_index = star_index + 1;
+			name_index = ++star_name_index;
+		} else
+			return false;
+	}
+
+	while (mask_index < mask.size() && mask[mask_index] == '*')
+		mask_index++;
+	return mask_index == mask.size();
+}
+
+// The usual shapes of a long ban list: nicknames, idents, addresses and domains
+static std::string ban_mask(int i)
+{
+	switch (i % 4) {
+		case 0:		return "spammer" + to_string(i) + "!*@*";
+		case 1:		return "*!~bot" + to_string(i) + "*@*";
+		case 2:		return "*!*@10." + to_string(i % 256) + "." + to_string(i / 256) + ".*";
+		default:	return "*!*@*.isp" + to_string(i) + ".example.net";
+	}
+}
+
+static void run_ban_match(int ban_count, int iterations)
+{
+	// Filled directly, a channel's list is capped by MAXLIST
+	std::vector<std::string> masks;
+	std::vector<Hostmask> compiled_masks;
+	MaskList ban_list;
+	for (int i = 0; i < ban_count; i++) {
+		masks.push_back(ban_mask(i));
+		compiled_masks.push_back(Hostmask(StringView(masks.back())));
+		ban_list.add(masks.back());
+	}
+
+	// A user who isn't banned, so that every mask has to be tried
+	User joining(100000, "192.168.1.42", 6667);
+	joining.set_nickname("Visitor");
+	joining.set_username("visitor");
+	std::string bans = to_string(ban_count) + " bans, ";
+	std::size_t joins = static_cast<std::size_t>(iterations);
+
+	{
+		std::size_t banned = 0;
+		std::size_t allocations = Benchmark::allocation_count();
+		double start = Benchmark::now();
+		for (int i = 0; i < iterations; i++) {
+			std::string source = joining.nickname() + "!~" + joining.username() + "@" + joining.ip();
+			for (std::size_t mask = 0; mask < masks.size(); mask++) {
+				if (interpreted_glob_match(StringView(masks[mask]), StringView(source)))
+					banned++;
+			}
+		}
+		Benchmark::report((bans + "interpreted globs").c_str(), joins, Benchmark::now() - start,
+			Benchmark::allocation_count() - allocations);
+		Benchmark::do_not_optimize(&banned);
+	}
+
+	{
+		std::size_t banned = 0;
+		std::size_t allocations = Benchmark::allocation_count();
+		double start = Benchmark::now();
+		for (int i = 0; i < iterations; i++) {
+			StringView source(joining.source());
+			for (std::size_t mask = 0; mask < compiled_masks.size(); mask++) {
+				if (compiled_masks[mask].matches(source))
+					banned++;
+			}
+		}
+		Benchmark::report((bans + "compiled masks one by one").c_str(), joins, Benchmark::now() - start,
+			Benchmark::allocation_count() - allocations);
+		Benchmark::do_not_optimize(&banned);
+	}
+
+	// What JOIN does through Channel::is_user_banned
+	{
+		std::size_t banned = 0;
+		std::size_t allocations = Benchmark::allocation_count();
+		double start = Benchmark::now();
+		for (int i = 0; i < iterations; i++) {
+			if (ban_list.matches(joining.source()))
+				banned++;
+		}
+		Benchmark::report((bans + "MaskList::matches").c_str(), joins, Benchmark::now() - start,
+			Benchmark::allocation_count() - allocations);
+		Benchmark::do_not_optimize(&banned);
+	}
+
+	// A -b then +b of the same mask
+	{
+		std::size_t allocations = Benchmark::allocation_count();
+		double start = Benchmark::now();
+		for (int i = 0; i < iterations; i++) {
+			const std::string& mask = masks[static_cast<std::size_t>(i % ban_count)];
+			ban_list.remove(mask);
+			ban_list.add(mask);
+		}
+		Benchmark::report((bans + "MaskList -b and +b").c_str(), joins, Benchmark::now() - start,
+			Benchmark::allocation_count() - allocations);
+	}
+}
+
+void benchmark_ban_match()
+{
+	run_ban_match(1000, 20000);
+	run_ban_match(10000, 2000);
+}
@@ -0,0 +1,60 @@
+//
+// Created by nathan on 4/6/23.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <ctime>
+#include "Benchmark.h"
+
+static std::size_t g_allocation_count = 0;
+
+void *operator new(std::size_t size) throw(std::bad_alloc)
+{
+	g_allocation_count++;
+	void *ptr = std::malloc(size ? size : 1);
+	if (!ptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void operator delete(void *ptr) throw()
+{
+	std::free(ptr);
+}
+
+namespace Benchmark
+{
+
+double now()
+{
+	timespec ts = {};
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+}
+
+std::size_t allocation_count()
+{
+	return g_allocation_count;
+}
+
+void report(const char *name, std::size_t iterations, double seconds, std::size_t allocations, std::size_t bytes)
+{
+	double ns_per_iteration = seconds * 1e9 / static_cast<double>(iterations);
+	double allocations_per_iteration = static_cast<double>(allocations) / static_cast<double>(iterations);
+
+	std::fprintf(stderr, "  %-40s %10.1f ns/op %8.2f allocs/op", name, ns_per_iteration, allocations_per_iteration);
+	if (bytes)
+		std::fprintf(stderr, " %9.1f MB/s", static_cast<double>(bytes) / seconds / 1e6);
+	std::fprintf(stderr, "\n");
+}
+
+const void *volatile optimization_sink = NULL;
+
+void do_not_optimize(const void *value)
+{
+	optimization_sink = value;
+}
+
+}
@@ -0,0 +1,35 @@
+//
+// Created by nathan on 4/6/23.
+//
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <cstddef>
+
+namespace Benchmark
+{
+
+typedef void (*benchmark_function)();
+
+struct Entry
+{
+	const char			*name;
+	benchmark_function	function;
+};
+
+/// Timing
+double		now();
+
+/// Heap allocations made since the start of the program
+std::size_t	allocation_count();
+
+/// Prints one line of results: time per iteration, throughput and allocations per iteration
+void		report(const char *name, std::size_t iterations, double seconds, std::size_t allocations, std::size_t bytes = 0);
+
+/// Keeps the optimizer from removing the benchmarked code
+void		do_not_optimize(const void *value);
+
+}
+
+#endif //BENCHMARK_H
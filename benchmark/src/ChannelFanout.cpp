@@ -0,0 +1,96 @@
+//
+// Created by nathan on 4/9/23.
+//
+
+#include <map>
+#include <vector>
+#include <string>
+#include "Benchmark.h"
+#include "Server.h"
+#include "Channel.h"
+#include "User.h"
+
+#define FANOUT_MEMBERS 10000
+#define FANOUT_ITERATIONS 200
+
+static const std::string message = ":alice!~alice@127.0.0.1 PRIVMSG #fanout :hello everyone, how is it going today?";
+
+// The messages are never sent, drop them so that no SendQ fills up
+static void clear_write_buffers(const std::vector<User*>& users)
+{
+	for (std::size_t i = 0; i < users.size(); i++)
+		users[i]->clear_write_buffer();
+}
+
+void benchmark_channel_fanout()
+{
+	std::vector<User*> users;
+	for (int i = 0; i < FANOUT_MEMBERS; i++) {
+		User *user = new User(100000 + i, "127.0.0.1", 6667);
+		user->set_nickname("user" + to_string(i));
+		users.push_back(user);
+	}
+
+	std::size_t deliveries = static_cast<std::size_t>(FANOUT_MEMBERS) * FANOUT_ITERATIONS;
+
+	// What broadcast_to_channel used to go through: a std::map keyed by the users
+	std::map<User*, UserPermissions> map_members;
+	for (std::size_t i = 0; i < users.size(); i++)
+		map_members[users[i]] = UserPermissions();
+
+	Channel *channel = new Channel(*users[0], "#fanout");
+	for (std::size_t i = 1; i < users.size(); i++)
+		channel->add_user(*users[i]);
+
+	// Going through the members alone, without touching the users
+	{
+		std::size_t operator_count = 0;
+		double start = Benchmark::now();
+		for (int i = 0; i < FANOUT_ITERATIONS; i++) {
+			for (std::map<User*, UserPermissions>::iterator member_it = map_members.begin(); member_it != map_members.end(); member_it++)
+				operator_count += member_it->second.is_operator() + (member_it->first != NULL);
+		}
+		Benchmark::report("std::map members, scan", deliveries, Benchmark::now() - start, 0);
+		Benchmark::do_not_optimize(&operator_count);
+	}
+	{
+		std::size_t operator_count = 0;
+		double start = Benchmark::now();
+		for (int i = 0; i < FANOUT_ITERATIONS; i++) {
+			for (Channel::UserIterator member_it = channel->users().begin(); member_it != channel->users().end(); member_it++)
+				operator_count += get_user_perms_reference(member_it).is_operator() + (&get_user_reference(member_it) != NULL);
+		}
+		Benchmark::report("ChannelMembers, scan", deliveries, Benchmark::now() - start, 0);
+		Benchmark::do_not_optimize(&operator_count);
+	}
+
+	// Whole broadcasts, where queueing the message for each user dominates
+	{
+		std::size_t allocations = Benchmark::allocation_count();
+		double start = Benchmark::now();
+		for (int i = 0; i < FANOUT_ITERATIONS; i++) {
+			SharedMessage shared_message(message);
+			for (std::map<User*, UserPermissions>::iterator member_it = map_members.begin(); member_it != map_members.end(); member_it++)
+				Server::reply(*member_it->first, shared_message);
+			clear_write_buffers(users);
+		}
+		Benchmark::report("std::map members, broadcast", deliveries, Benchmark::now() - start,
+			Benchmark::allocation_count() - allocations);
+	}
+
+	{
+		std::size_t allocations = Benchmark::allocation_count();
+		double start = Benchmark::now();
+		for (int i = 0; i < FANOUT_ITERATIONS; i++) {
+			Server::broadcast_to_channel(*channel, message);
+			clear_write_buffers(users);
+		}
+		Benchmark::report("ChannelMembers, broadcast", deliveries, Benchmark::now() - start,
+			Benchmark::allocation_count() - allocations);
+	}
+
+	delete channel;
+
+	for (std::size_t i = 0; i < users.size(); i++)
+		delete users[i];
+}
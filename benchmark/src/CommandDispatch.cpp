@@ -0,0 +1,83 @@
+//
+// Created by nathan on 4/8/23.
+//
+
+#include <map>
+#include <string>
+#include <vector>
+#include "Benchmark.h"
+#include "CommandTable.h"
+#include "Utils.h"
+
+#define DISPATCH_ITERATIONS 500000
+
+typedef int (*command_function)();
+
+static int g_calls = 0;
+static int dummy_command() { return ++g_calls; }
+
+// Mostly messages and pings, as seen on a busy server
+static const char *command_names[] = {
+	"PRIVMSG", "privmsg", "PING", "PONG", "PRIVMSG", "JOIN", "MODE", "NOTICE", "WHO", "PART", "PRIVMSG", "UNKNOWNCMD",
+};
+
+static const std::size_t command_name_count = sizeof(command_names) / sizeof(command_names[0]);
+
+void benchmark_command_dispatch()
+{
+	std::vector<std::string> corpus(command_names, command_names + command_name_count);
+	std::size_t iterations = corpus.size() * DISPATCH_ITERATIONS;
+
+	// What execute_command used to do: upper case copy, map lookups by name and stats by name
+	{
+		std::map<std::string, command_function> commands;
+		std::map<std::string, command_function> connection_commands;
+		std::map<std::string, std::size_t> command_stats;
+		for (int i = 0; i < COMMAND_COUNT; i++)
+			commands[CommandTable::name(static_cast<CommandId>(i))] = dummy_command;
+		connection_commands["CAP"] = dummy_command;
+		connection_commands["NICK"] = dummy_command;
+
+		std::size_t allocations = Benchmark::allocation_count();
+		double start = Benchmark::now();
+		for (std::size_t i = 0; i < DISPATCH_ITERATIONS; i++) {
+			for (std::size_t command = 0; command < corpus.size(); command++) {
+				std::string command_name = to_upper(corpus[command]);
+				std::map<std::string, command_function>::iterator command_it = commands.find(command_name);
+				if (command_it != commands.end()) {
+					command_stats[command_name]++;
+					command_it->second();
+				} else if (connection_commands.find(command_name) != connection_commands.end())
+					g_calls--;
+			}
+		}
+		Benchmark::report("std::map by upper case name", iterations, Benchmark::now() - start,
+			Benchmark::allocation_count() - allocations);
+	}
+
+	// Perfect hash to a dense id, then flat arrays
+	{
+		command_function functions[COMMAND_COUNT];
+		std::size_t counts[COMMAND_COUNT] = {};
+		for (int i = 0; i < COMMAND_COUNT; i++)
+			functions[i] = dummy_command;
+
+		std::size_t allocations = Benchmark::allocation_count();
+		double start = Benchmark::now();
+		for (std::size_t i = 0; i < DISPATCH_ITERATIONS; i++) {
+			for (std::size_t command = 0; command < corpus.size(); command++) {
+				CommandId id = CommandTable::find(StringView(corpus[command]));
+				if (id != COMMAND_UNKNOWN) {
+					counts[id]++;
+					functions[id]();
+				} else
+					g_calls--;
+			}
+		}
+		Benchmark::report("CommandTable + flat arrays", iterations, Benchmark::now() - start,
+			Benchmark::allocation_count() - allocations);
+		Benchmark::do_not_optimize(counts);
+	}
+
+	Benchmark::do_not_optimize(&g_calls);
+}
@@ -0,0 +1,84 @@
+//
+// Created by nathan on 4/6/23.
+//
+
+#include <string>
+#include <vector>
+#include "Benchmark.h"
+#include "Command.h"
+#include "CommandView.h"
+
+#define PARSER_ITERATIONS 200000
+
+// Typical client traffic
+static const char *lines[] = {
+	"PRIVMSG #general :hello everyone, how is it going today?\r\n",
+	"PING :irc.example.com\r\n",
+	"JOIN #general,#random key1\r\n",
+	"MODE #general +ov alice bob\r\n",
+	":alice!~alice@127.0.0.1 PRIVMSG bob :are you there?\r\n",
+	"@time=2023-04-06T12:00:00.000Z;+example.com/tag=1 PRIVMSG #general :tagged message\r\n",
+	"WHO #general\r\n",
+	"NICK alice_\r\n",
+};
+
+static const std::size_t line_count = sizeof(lines) / sizeof(lines[0]);
+
+static std::size_t corpus_size(const std::vector<std::string>& corpus)
+{
+	std::size_t size = 0;
+	for (std::size_t i = 0; i < corpus.size(); i++)
+		size += corpus[i].size();
+	return size;
+}
+
+void benchmark_command_parser()
+{
+	std::vector<std::string> corpus(lines, lines + line_count);
+	std::size_t bytes = corpus_size(corpus) * PARSER_ITERATIONS;
+	std::size_t iterations = corpus.size() * PARSER_ITERATIONS;
+
+	// Command copying the line and building owned strings while parsing
+	{
+		std::size_t allocations = Benchmark::allocation_count();
+		double start = Benchmark::now();
+		for (std::size_t i = 0; i < PARSER_ITERATIONS; i++) {
+			for (std::size_t line = 0; line < corpus.size(); line++) {
+				Command command(corpus[line]);
+				Benchmark::do_not_optimize(&command);
+			}
+		}
+		Benchmark::report("Command(std::string)", iterations, Benchmark::now() - start,
+			Benchmark::allocation_count() - allocations, bytes);
+	}
+
+	// In place parsing only
+	{
+		std::size_t allocations = Benchmark::allocation_count();
+		double start = Benchmark::now();
+		CommandView view;
+		for (std::size_t i = 0; i < PARSER_ITERATIONS; i++) {
+			for (std::size_t line = 0; line < corpus.size(); line++) {
+				view.parse(StringView(corpus[line]));
+				Benchmark::do_not_optimize(&view);
+			}
+		}
+		Benchmark::report("CommandView", iterations, Benchmark::now() - start,
+			Benchmark::allocation_count() - allocations, bytes);
+	}
+
+	// In place parsing, then owned copies for the handlers
+	{
+		std::size_t allocations = Benchmark::allocation_count();
+		double start = Benchmark::now();
+		for (std::size_t i = 0; i < PARSER_ITERATIONS; i++) {
+			for (std::size_t line = 0; line < corpus.size(); line++) {
+				CommandView view((StringView(corpus[line])));
+				Command command(view);
+				Benchmark::do_not_optimize(&command);
+			}
+		}
+		Benchmark::report("CommandView + Command(CommandView)", iterations, Benchmark::now() - start,
+			Benchmark::allocation_count() - allocations, bytes);
+	}
+}
@@ -0,0 +1,98 @@
+//
+// Created by nathan on 4/7/23.
+//
+
+#include <string>
+#include <cstdio>
+#include "Benchmark.h"
+#include "CharScanner.h"
+
+#define SCANNER_BYTES_PER_RUN (64 * 1024 * 1024)
+
+typedef std::size_t (*find_function)(const char *, std::size_t, const char *);
+
+static std::size_t find_first_of_std_string(const char *data, std::size_t size, const char *chars)
+{
+	// What the input path used to do: the rest of the buffer is moved for each line
+	static std::string buffer;
+	buffer.assign(data, size);
+	return buffer.find_first_of(chars);
+}
+
+static std::size_t find_first_of_std_string_no_copy(const char *data, std::size_t size, const char *chars)
+{
+	static std::string buffer;
+	if (buffer.data() != data)
+		buffer.assign(data, size);
+	return buffer.find_first_of(chars);
+}
+
+static void run(const char *name, find_function function, const std::string& buffer, const char *chars)
+{
+	std::size_t iterations = SCANNER_BYTES_PER_RUN / buffer.size();
+	std::size_t found = 0;
+
+	std::size_t allocations = Benchmark::allocation_count();
+	double start = Benchmark::now();
+	for (std::size_t i = 0; i < iterations; i++)
+		found += function(buffer.data(), buffer.size(), chars);
+	double seconds = Benchmark::now() - start;
+	Benchmark::do_not_optimize(&found);
+
+	Benchmark::report(name, iterations, seconds, Benchmark::allocation_count() - allocations, iterations * buffer.size());
+}
+
+static void run_all(const std::string& buffer, const char *chars, const char *chars_name)
+{
+	std::fprintf(stderr, " %llu bytes, looking for %s:\n", static_cast<unsigned long long>(buffer.size()), chars_name);
+	run("std::string::find_first_of", find_first_of_std_string_no_copy, buffer, chars);
+	run("CharScanner scalar", CharScanner::find_first_of_scalar, buffer, chars);
+#ifdef CHAR_SCANNER_X86
+	run("CharScanner sse2", CharScanner::find_first_of_sse2, buffer, chars);
+	if (CharScanner::is_avx2_supported())
+		run("CharScanner avx2", CharScanner::find_first_of_avx2, buffer, chars);
+#endif
+}
+
+static void run_line_split(const char *name, find_function function, const std::string& paste)
+{
+	std::size_t allocations = Benchmark::allocation_count();
+	double start = Benchmark::now();
+	std::size_t iterations = SCANNER_BYTES_PER_RUN / paste.size();
+	std::size_t line_count = 0;
+	for (std::size_t i = 0; i < iterations; i++) {
+		std::size_t offset = 0;
+		while (offset < paste.size()) {
+			std::size_t line_end = function(paste.data() + offset, paste.size() - offset, "\r\n");
+			if (line_end == CharScanner::npos || line_end == std::string::npos)
+				break ;
+			offset += line_end + 2;
+			line_count++;
+		}
+	}
+	double seconds = Benchmark::now() - start;
+	Benchmark::do_not_optimize(&line_count);
+	Benchmark::report(name, line_count, seconds, Benchmark::allocation_count() - allocations, iterations * paste.size());
+}
+
+void benchmark_delimiter_scanner()
+{
+	std::fprintf(stderr, " selected implementation: %s\n", CharScanner::implementation_name());
+
+	// The delimiter is at the end of the buffer, the whole buffer is scanned
+	std::size_t sizes[] = { 16, 64, 512, 8192 };
+	for (std::size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		std::string buffer(sizes[i] - 1, 'a');
+		buffer += '\n';
+		run_all(buffer, "\r\n", "CR LF");
+		run_all(buffer, "\r\n: ", "CR LF ':' ' '");
+	}
+
+	// Splitting a 64 KB paste into lines
+	std::string paste;
+	while (paste.size() < 64 * 1024)
+		paste += "PRIVMSG #general :some line of a big paste, about sixty bytes\r\n";
+	std::fprintf(stderr, " splitting a %llu bytes paste into lines:\n", static_cast<unsigned long long>(paste.size()));
+	run_line_split("std::string, moving the rest per line", find_first_of_std_string, paste);
+	run_line_split("CharScanner::find_first_of", CharScanner::find_first_of, paste);
+}
@@ -0,0 +1,66 @@
+//
+// Created by nathan on 4/10/23.
+//
+
+#include <string>
+#include <cstdio>
+#include <unistd.h>
+#include "Benchmark.h"
+#include "log.h"
+#include "Utils.h"
+
+#define LOGGING_ITERATIONS 200000
+// Bursts smaller than a ring, so that nothing is dropped
+#define LOGGING_BATCH 1000
+#define LOGGING_PAUSE_USEC 2000
+
+typedef void (*log_function)(const std::string& ip, int port, const std::string& line);
+
+// What Server::reply traces for every message
+static void log_reply(const std::string& ip, int port, const std::string& line)
+{
+	CORE_TRACE("REPLYING TO %s:%d [%s]", ip.c_str(), port, line.c_str());
+}
+
+// Arguments that allocate, like the debug names of the users used to
+static void log_built_name(const std::string& ip, int port, const std::string& line)
+{
+	CORE_TRACE("INCOMING FROM %s[%s]", (ip + ":" + to_string(port)).c_str(), line.c_str());
+}
+
+static void run_logging(const char *name, log_function function)
+{
+	std::string ip = "192.168.1.42";
+	std::string line = ":alice!~alice@127.0.0.1 PRIVMSG #channel :some message of a usual length for a channel";
+
+	std::size_t dropped = Log::dropped_count();
+	std::size_t allocations = Benchmark::allocation_count();
+	double seconds = 0;
+	for (int i = 0; i < LOGGING_ITERATIONS; i += LOGGING_BATCH) {
+		double start = Benchmark::now();
+		for (int j = 0; j < LOGGING_BATCH; j++)
+			function(ip, 6667, line);
+		seconds += Benchmark::now() - start;
+		// Lets the writer thread catch up, outside of the measure
+		usleep(LOGGING_PAUSE_USEC);
+	}
+	Benchmark::report(name, LOGGING_ITERATIONS, seconds, Benchmark::allocation_count() - allocations);
+	if (Log::dropped_count() != dropped)
+		std::fprintf(stderr, "    %llu messages dropped\n", static_cast<unsigned long long>(Log::dropped_count() - dropped));
+}
+
+void benchmark_logging()
+{
+	// The benchmarks are run with stdout going to /dev/null
+	Log::Level previous_level = Log::level();
+	Log::set_level(Log::LEVEL_TRACE);
+	run_logging("synchronous, stdout", log_reply);
+
+	Log::start("/dev/null");
+	run_logging("ring buffer, writer thread", log_reply);
+	Log::set_level(Log::LEVEL_INFO);
+	run_logging("under the level", log_reply);
+	run_logging("under the level, allocating arguments", log_built_name);
+	Log::set_level(previous_level);
+	Log::stop();
+}
@@ -0,0 +1,110 @@
+//
+// Created by nathan on 4/9/23.
+//
+
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include "Benchmark.h"
+#include "Channel.h"
+#include "User.h"
+
+#define WHO_USERS 50000
+#define WHO_CHANNELS 2000
+#define WHO_CHANNELS_PER_USER 10
+#define WHO_ITERATIONS 20
+
+// What has_channel_in_common used to do: compare the names of every pair of channels
+static bool has_channel_in_common_by_name(const User& user, const User& other_user)
+{
+	for (User::ConstChannelIterator channel_it = user.channels().begin(); channel_it != user.channels().end(); ++channel_it) {
+		for (User::ConstChannelIterator other_it = other_user.channels().begin(); other_it != other_user.channels().end(); ++other_it) {
+			if (get_channel_reference(channel_it).name() == get_channel_reference(other_it).name())
+				return true;
+		}
+	}
+	return false;
+}
+
+static void join(User& user, std::vector<Channel*>& channels, std::size_t channel_index)
+{
+	Channel *&channel = channels[channel_index];
+	if (!channel) {
+		channel = new Channel(user, "#channel" + to_string(channel_index));
+		return ;
+	}
+	if (channel->has_user(user))
+		return ;
+	channel->add_user(user);
+	user.add_channel(*channel);
+}
+
+void benchmark_who_scan()
+{
+	// Invisible users spread over many channels, WHO then has to look for a common channel
+	std::srand(42);
+	std::vector<User*> users;
+	std::vector<Channel*> channels(WHO_CHANNELS, NULL);
+	for (int i = 0; i < WHO_USERS; i++) {
+		User *user = new User(100000 + i, "127.0.0.1", 6667);
+		user->set_nickname("user" + to_string(i));
+		users.push_back(user);
+		for (int channel = 0; channel < WHO_CHANNELS_PER_USER; channel++)
+			join(*user, channels, static_cast<std::size_t>(std::rand() % WHO_CHANNELS));
+	}
+
+	User& requester = *users[0];
+	std::size_t candidates = static_cast<std::size_t>(WHO_USERS) * WHO_ITERATIONS;
+
+	{
+		std::size_t visible = 0;
+		std::size_t allocations = Benchmark::allocation_count();
+		double start = Benchmark::now();
+		for (int i = 0; i < WHO_ITERATIONS; i++) {
+			for (std::size_t user = 0; user < users.size(); user++) {
+				if (has_channel_in_common_by_name(*users[user], requester))
+					visible++;
+			}
+		}
+		Benchmark::report("channel names compared by pairs", candidates, Benchmark::now() - start,
+			Benchmark::allocation_count() - allocations);
+		Benchmark::do_not_optimize(&visible);
+	}
+
+	{
+		std::size_t visible = 0;
+		std::size_t allocations = Benchmark::allocation_count();
+		double start = Benchmark::now();
+		for (int i = 0; i < WHO_ITERATIONS; i++) {
+			for (std::size_t user = 0; user < users.size(); user++) {
+				if (users[user]->is_visible_to_user(requester))
+					visible++;
+			}
+		}
+		Benchmark::report("membership lookups", candidates, Benchmark::now() - start,
+			Benchmark::allocation_count() - allocations);
+		Benchmark::do_not_optimize(&visible);
+	}
+
+	// What WHO does: mark the requester's channel neighbours once per scan
+	{
+		std::size_t visible = 0;
+		std::size_t allocations = Benchmark::allocation_count();
+		double start = Benchmark::now();
+		for (int i = 0; i < WHO_ITERATIONS; i++) {
+			requester.mark_users_sharing_a_channel();
+			for (std::size_t user = 0; user < users.size(); user++) {
+				if (users[user]->is_visible_to_marking_user())
+					visible++;
+			}
+		}
+		Benchmark::report("marks set once per scan", candidates, Benchmark::now() - start,
+			Benchmark::allocation_count() - allocations);
+		Benchmark::do_not_optimize(&visible);
+	}
+
+	for (std::size_t i = 0; i < channels.size(); i++)
+		delete channels[i];
+	for (std::size_t i = 0; i < users.size(); i++)
+		delete users[i];
+}
@@ -0,0 +1,45 @@
+//
+// Created by nathan on 4/6/23.
+//
+
+#include <cstdio>
+#include <cstring>
+#include "Benchmark.h"
+
+void benchmark_command_parser();
+void benchmark_delimiter_scanner();
+void benchmark_command_dispatch();
+void benchmark_channel_fanout();
+void benchmark_who_scan();
+void benchmark_ban_match();
+void benchmark_logging();
+
+static const Benchmark::Entry benchmarks[] = {
+	{ "command_parser",		benchmark_command_parser },
+	{ "delimiter_scanner",	benchmark_delimiter_scanner },
+	{ "command_dispatch",	benchmark_command_dispatch },
+	{ "channel_fanout",		benchmark_channel_fanout },
+	{ "who_scan",			benchmark_who_scan },
+	{ "ban_match",			benchmark_ban_match },
+	{ "logging",			benchmark_logging },
+};
+
+static const std::size_t benchmark_count = sizeof(benchmarks) / sizeof(benchmarks[0]);
+
+int main(int argc, char **argv)
+{
+	// Results go to stderr, the server's logs go to stdout
+	for (std::size_t i = 0; i < benchmark_count; i++) {
+		bool is_selected = argc < 2;
+		for (int arg = 1; arg < argc; arg++) {
+			if (std::strcmp(argv[arg], benchmarks[i].name) == 0)
+				is_selected = true;
+		}
+		if (!is_selected)
+			continue;
+
+		std::fprintf(stderr, "%s:\n", benchmarks[i].name);
+		benchmarks[i].function();
+	}
+	return 0;
+}
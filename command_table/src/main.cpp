@@ -0,0 +1,127 @@
+//
+// Created by nathan on 4/8/23.
+//
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "CommandHash.h"
+
+// Generates the slots of the CommandTable perfect hash from src/CommandList.h:
+//  looks for the smallest table, then the smallest multipliers, for which no two
+//  commands share a slot, and writes them as a header included by CommandTable.cpp.
+//  Run by the Makefiles, the build fails if no perfect hash is found.
+
+#define MIN_TABLE_SIZE		32
+#define MAX_TABLE_SIZE		512
+#define MAX_MULTIPLIER		255
+
+static const char *names[] = {
+#define COMMAND_ENTRY(name) #name,
+#include "CommandList.h"
+#undef COMMAND_ENTRY
+};
+
+static const std::size_t command_count = sizeof(names) / sizeof(names[0]);
+
+struct PerfectHash
+{
+	std::size_t			table_size;
+	std::size_t			second_char_multiplier;
+	std::size_t			last_char_multiplier;
+	// Command index of each slot, command_count when empty
+	std::vector<std::size_t>	slots;
+};
+
+static bool try_hash(PerfectHash& hash)
+{
+	hash.slots.assign(hash.table_size, command_count);
+	for (std::size_t i = 0; i < command_count; i++) {
+		std::size_t slot = CommandHash::hash(names[i], std::strlen(names[i]),
+			hash.second_char_multiplier, hash.last_char_multiplier, hash.table_size);
+		if (hash.slots[slot] != command_count)
+			return false;
+		hash.slots[slot] = i;
+	}
+	return true;
+}
+
+static bool find_hash(PerfectHash& hash)
+{
+	for (hash.table_size = MIN_TABLE_SIZE; hash.table_size <= MAX_TABLE_SIZE; hash.table_size *= 2) {
+		if (hash.table_size < command_count)
+			continue;
+		for (hash.second_char_multiplier = 1; hash.second_char_multiplier <= MAX_MULTIPLIER; hash.second_char_multiplier++) {
+			for (hash.last_char_multiplier = 1; hash.last_char_multiplier <= MAX_MULTIPLIER; hash.last_char_multiplier++) {
+				if (try_hash(hash))
+					return true;
+			}
+		}
+	}
+	return false;
+}
+
+static bool write_header(const PerfectHash& hash, const char *path)
+{
+	std::size_t min_length = std::strlen(names[0]);
+	std::size_t max_length = min_length;
+	for (std::size_t i = 1; i < command_count; i++) {
+		std::size_t length = std::strlen(names[i]);
+		if (length < min_length)
+			min_length = length;
+		if (length > max_length)
+			max_length = length;
+	}
+
+	std::FILE *file = std::fopen(path, "w");
+	if (file == NULL) {
+		std::perror(path);
+		return false;
+	}
+
+	std::fprintf(file, "// Generated by command_table_generator from CommandList.h, do not edit\n\n");
+	std::fprintf(file, "#define COMMAND_TABLE_SIZE\t\t\t%lu\n", static_cast<unsigned long>(hash.table_size));
+	std::fprintf(file, "#define COMMAND_NAME_MIN_LENGTH\t\t%lu\n", static_cast<unsigned long>(min_length));
+	std::fprintf(file, "#define COMMAND_NAME_MAX_LENGTH\t\t%lu\n\n", static_cast<unsigned long>(max_length));
+	std::fprintf(file, "// Multipliers of the second and last characters\n");
+	std::fprintf(file, "#define COMMAND_HASH_SECOND_CHAR\t%lu\n", static_cast<unsigned long>(hash.second_char_multiplier));
+	std::fprintf(file, "#define COMMAND_HASH_LAST_CHAR\t\t%lu\n\n", static_cast<unsigned long>(hash.last_char_multiplier));
+	std::fprintf(file, "// Indexed by hash\n");
+	std::fprintf(file, "static const CommandId slots[COMMAND_TABLE_SIZE] = {\n");
+	for (std::size_t i = 0; i < hash.table_size; i++) {
+		const char *name = hash.slots[i] == command_count ? "UNKNOWN" : names[hash.slots[i]];
+		std::fprintf(file, "%sCOMMAND_%s,%s", i % 4 == 0 ? "\t" : "", name, i % 4 == 3 ? "\n" : " ");
+	}
+	if (hash.table_size % 4 != 0)
+		std::fprintf(file, "\n");
+	std::fprintf(file, "};\n");
+
+	if (std::fclose(file) != 0) {
+		std::perror(path);
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc != 2) {
+		std::fprintf(stderr, "Usage: command_table_generator <header>\n");
+		return 1;
+	}
+
+	for (std::size_t i = 0; i < command_count; i++) {
+		if (std::strlen(names[i]) < 2) {
+			std::fprintf(stderr, "command_table_generator: command %s is too short to be hashed\n", names[i]);
+			return 1;
+		}
+	}
+
+	PerfectHash hash;
+	if (!find_hash(hash)) {
+		std::fprintf(stderr, "command_table_generator: no perfect hash of the %lu commands up to %d slots, "
+			"see src/CommandHash.h\n", static_cast<unsigned long>(command_count), MAX_TABLE_SIZE);
+		return 1;
+	}
+	return write_header(hash, argv[1]) ? 0 : 1;
+}
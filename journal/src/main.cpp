@@ -0,0 +1,181 @@
+//
+// Created by nathan on 4/10/23.
+//
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <vector>
+#include <strings.h>
+#include <unistd.h>
+#include "Journal.h"
+#include "CommandTable.h"
+
+// Prints the records of the traffic journals written by irc_server, see src/Journal.h
+
+struct Filters
+{
+	std::vector<uint32_t>	connections;
+	std::vector<CommandId>	commands;
+	int						direction;		// -1 for both
+};
+
+static void print_usage()
+{
+	std::fprintf(stderr,
+		"Usage: irc_journal [-c connection] [-C command] [-d in|out] <journal>...\n"
+		"  -c connection  only the records of this connection id, can be repeated\n"
+		"  -C command     only the records of this command, UNKNOWN for the ones outside of\n"
+		"                 a known command; the outgoing lines belong to the command that sent them\n"
+		"  -d in|out      only the received or the sent lines\n"
+		"The journals are printed in the order given, journal.3 journal.2 journal.1 journal\n"
+		"  to go from the oldest to the newest.\n");
+}
+
+static bool parse_command(const char *name, CommandId& id)
+{
+	if (strcasecmp(name, "UNKNOWN") == 0) {
+		id = COMMAND_UNKNOWN;
+		return true;
+	}
+	id = CommandTable::find(StringView(name, std::strlen(name)));
+	return id != COMMAND_UNKNOWN;
+}
+
+template <typename T>
+static bool contains(const std::vector<T>& values, T value)
+{
+	for (typename std::vector<T>::const_iterator it = values.begin(); it != values.end(); ++it) {
+		if (*it == value)
+			return true;
+	}
+	return false;
+}
+
+static bool is_selected(const Journal::RecordHeader& record, const Filters& filters)
+{
+	if (!filters.connections.empty() && !contains(filters.connections, record.connection))
+		return false;
+	if (!filters.commands.empty() && !contains(filters.commands, static_cast<CommandId>(record.command)))
+		return false;
+	return filters.direction < 0 || filters.direction == record.direction;
+}
+
+static void print_record(const Journal::RecordHeader& record, const char *line)
+{
+	std::time_t seconds = static_cast<std::time_t>(record.timestamp / 1000000);
+	char date[32];
+	std::strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", std::localtime(&seconds));
+
+	const char *command = record.command < COMMAND_COUNT ? CommandTable::name(static_cast<CommandId>(record.command)) : "-";
+	std::printf("%s.%06u #%-6u %s %-8s ", date, static_cast<unsigned>(record.timestamp % 1000000),
+		record.connection, record.direction == Journal::DIRECTION_IN ? "<<" : ">>", command);
+
+	// The lines come from the clients, they mustn't write to the terminal
+	for (uint32_t i = 0; i < record.length; i++) {
+		unsigned char c = static_cast<unsigned char>(line[i]);
+		if (c < 0x20 || c == 0x7F)
+			std::printf("\\x%02X", c);
+		else
+			std::putchar(c);
+	}
+	std::putchar('\n');
+}
+
+static bool print_journal(const char *path, const Filters& filters)
+{
+	std::ifstream file(path, std::ios::in | std::ios::binary);
+	if (!file.good()) {
+		std::fprintf(stderr, "irc_journal: couldn't open %s: %s\n", path, std::strerror(errno));
+		return false;
+	}
+	std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	Journal::FileHeader header;
+	if (data.size() < sizeof(header)) {
+		std::fprintf(stderr, "irc_journal: %s is too short to be a journal\n", path);
+		return false;
+	}
+	std::memcpy(&header, &data[0], sizeof(header));
+	if (std::memcmp(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 || header.version != JOURNAL_VERSION
+		|| header.header_size < sizeof(Journal::RecordHeader)) {
+		std::fprintf(stderr, "irc_journal: %s isn't a version %d journal\n", path, JOURNAL_VERSION);
+		return false;
+	}
+
+	// A server that crashed leaves the preallocated space after the last record
+	std::size_t end = header.end < data.size() ? static_cast<std::size_t>(header.end) : data.size();
+	std::size_t offset = sizeof(header);
+	while (offset + header.header_size <= end) {
+		Journal::RecordHeader record;
+		std::memcpy(&record, &data[offset], sizeof(record));
+		offset += header.header_size;
+		if (offset + record.length > end) {
+			std::fprintf(stderr, "irc_journal: %s: the last record is cut\n", path);
+			return false;
+		}
+		if (is_selected(record, filters))
+			print_record(record, &data[offset]);
+		offset += record.length;
+	}
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	Filters filters;
+	filters.direction = -1;
+
+	int option;
+	while ((option = getopt(argc, argv, "c:C:d:h")) != -1) {
+		switch (option) {
+			case 'c': {
+				char *end;
+				unsigned long connection = std::strtoul(optarg, &end, 10);
+				if (*optarg == '\0' || *end != '\0') {
+					std::fprintf(stderr, "irc_journal: invalid connection id [%s]\n", optarg);
+					return 1;
+				}
+				filters.connections.push_back(static_cast<uint32_t>(connection));
+				break ;
+			}
+			case 'C': {
+				CommandId id;
+				if (!parse_command(optarg, id)) {
+					std::fprintf(stderr, "irc_journal: unknown command [%s]\n", optarg);
+					return 1;
+				}
+				filters.commands.push_back(id);
+				break ;
+			}
+			case 'd':
+				if (strcasecmp(optarg, "in") == 0)
+					filters.direction = Journal::DIRECTION_IN;
+				else if (strcasecmp(optarg, "out") == 0)
+					filters.direction = Journal::DIRECTION_OUT;
+				else {
+					std::fprintf(stderr, "irc_journal: the direction is either in or out, not [%s]\n", optarg);
+					return 1;
+				}
+				break ;
+			default:
+				print_usage();
+				return 1;
+		}
+	}
+
+	if (optind == argc) {
+		print_usage();
+		return 1;
+	}
+
+	int status = 0;
+	for (int i = optind; i < argc; i++) {
+		if (!print_journal(argv[i], filters))
+			status = 1;
+	}
+	return status;
+}
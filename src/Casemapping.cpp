@@ -0,0 +1,111 @@
+//
+// Created by nathan on 4/9/23.
+//
+
+#include "Casemapping.h"
+
+// The tables are built from constant expressions so that they are initialized
+//  statically, before any other code can fold a character
+#define FOLD_ASCII(c)			((c) >= 'a' && (c) <= 'z' ? (c) - ('a' - 'A') : (c))
+#define FOLD_STRICT_RFC1459(c)	((c) >= '{' && (c) <= '}' ? (c) - ('{' - '[') : FOLD_ASCII(c))
+#define FOLD_RFC1459(c)			((c) == '~' ? '^' : FOLD_STRICT_RFC1459(c))
+
+#define FOLD_ROW(fold, c) \
+	fold((c) + 0), fold((c) + 1), fold((c) + 2), fold((c) + 3), \
+	fold((c) + 4), fold((c) + 5), fold((c) + 6), fold((c) + 7), \
+	fold((c) + 8), fold((c) + 9), fold((c) + 10), fold((c) + 11), \
+	fold((c) + 12), fold((c) + 13), fold((c) + 14), fold((c) + 15)
+
+#define FOLD_TABLE(fold) { \
+	FOLD_ROW(fold, 0), FOLD_ROW(fold, 16), FOLD_ROW(fold, 32), FOLD_ROW(fold, 48), \
+	FOLD_ROW(fold, 64), FOLD_ROW(fold, 80), FOLD_ROW(fold, 96), FOLD_ROW(fold, 112), \
+	FOLD_ROW(fold, 128), FOLD_ROW(fold, 144), FOLD_ROW(fold, 160), FOLD_ROW(fold, 176), \
+	FOLD_ROW(fold, 192), FOLD_ROW(fold, 208), FOLD_ROW(fold, 224), FOLD_ROW(fold, 240) }
+
+namespace Casemapping
+{
+
+struct Mapping
+{
+	const char			*name;
+	unsigned char		table[256];
+};
+
+// Indexed by Type
+static const Mapping	mappings[] = {
+	{ "ascii", FOLD_TABLE(FOLD_ASCII) },
+	{ "strict-rfc1459", FOLD_TABLE(FOLD_STRICT_RFC1459) },
+	{ "rfc1459", FOLD_TABLE(FOLD_RFC1459) }
+};
+
+static Type					current_type = ASCII;
+static const unsigned char	*table = mappings[ASCII].table;
+
+bool set(const std::string& name)
+{
+	for (std::size_t i = 0; i < sizeof(mappings) / sizeof(*mappings); i++) {
+		if (name == mappings[i].name) {
+			current_type = static_cast<Type>(i);
+			table = mappings[i].table;
+			return true;
+		}
+	}
+	return false;
+}
+
+Type current()
+{
+	return current_type;
+}
+
+const char *name()
+{
+	return mappings[current_type].name;
+}
+
+char fold(char c)
+{
+	return static_cast<char>(table[static_cast<unsigned char>(c)]);
+}
+
+bool equals(const StringView& lhs, const StringView& rhs)
+{
+	if (lhs.size() != rhs.size())
+		return false;
+	for (std::size_t i = 0; i < lhs.size(); i++) {
+		if (table[static_cast<unsigned char>(lhs[i])] != table[static_cast<unsigned char>(rhs[i])])
+			return false;
+	}
+	return true;
+}
+
+bool equals(const std::string& lhs, const std::string& rhs)
+{
+	return equals(StringView(lhs), StringView(rhs));
+}
+
+int compare(const StringView& lhs, const StringView& rhs)
+{
+	std::size_t size = lhs.size() < rhs.size() ? lhs.size() : rhs.size();
+	for (std::size_t i = 0; i < size; i++) {
+		int difference = table[static_cast<unsigned char>(lhs[i])] - table[static_cast<unsigned char>(rhs[i])];
+		if (difference != 0)
+			return difference;
+	}
+	if (lhs.size() == rhs.size())
+		return 0;
+	return lhs.size() < rhs.size() ? -1 : 1;
+}
+
+std::size_t hash(const StringView& str)
+{
+	// FNV-1a over the folded characters
+	std::size_t h = static_cast<std::size_t>(14695981039346656037ULL);
+	for (std::size_t i = 0; i < str.size(); i++) {
+		h ^= table[static_cast<unsigned char>(str[i])];
+		h *= static_cast<std::size_t>(1099511628211ULL);
+	}
+	return h;
+}
+
+}
@@ -0,0 +1,52 @@
+//
+// Created by nathan on 4/9/23.
+//
+
+#ifndef CASEMAPPING_H
+#define CASEMAPPING_H
+
+#include <string>
+#include <cstddef>
+#include "StringView.h"
+
+// Case insensitive handling of nicknames and channel names. Each mapping is a
+//  256 entries table folding a character to its upper case equivalent:
+//  - ascii:			a-z to A-Z
+//  - strict-rfc1459:	ascii, and {|} to [\]
+//  - rfc1459:			strict-rfc1459, and ~ to ^
+//  The compares and hashes fold the characters on the fly, they never allocate.
+namespace Casemapping
+{
+
+enum Type
+{
+	ASCII,
+	STRICT_RFC1459,
+	RFC1459
+};
+
+/// Selects a mapping from its ISUPPORT name, false if it is unknown.
+///  The nickname and channel indexes depend on it: only change it on startup.
+bool		set(const std::string& name);
+Type		current();
+/// ISUPPORT name of the current mapping
+const char	*name();
+
+char		fold(char c);
+bool		equals(const StringView& lhs, const StringView& rhs);
+bool		equals(const std::string& lhs, const std::string& rhs);
+/// Negative, zero or positive like strcmp
+int			compare(const StringView& lhs, const StringView& rhs);
+std::size_t	hash(const StringView& str);
+
+/// Case insensitive ordering, for the keys of the std::map
+struct Less
+{
+	bool operator()(const std::string& lhs, const std::string& rhs) const {
+		return compare(StringView(lhs), StringView(rhs)) < 0;
+	}
+};
+
+}
+
+#endif //CASEMAPPING_H
@@ -7,23 +7,13 @@
 #include <map>
 #include "Channel.h"
 #include "Utils.h"
+#include "Casemapping.h"
+#include "Hostmask.h"
 #include "Server.h"
 #include "Numerics.h"
 
-Channel::UserPermissions::UserPermissions()
-: m_is_operator(false), m_has_voice(false) {}
-
-std::string Channel::UserPermissions::get_highest_prefix() const
-{
-	if (m_is_operator)
-		return CHANNEL_USER_PREFIX_OPERATOR;
-	else if (m_has_voice)
-		return CHANNEL_USER_PREFIX_VOICE;
-	return "";
-}
-
 Channel::Channel(User& user, const std::string &name) :
-	m_name(name), m_name_to_upper(to_upper(name)),
+	m_name(name),
 	m_creation_date(time(NULL)),
 	m_topic_modification_date(m_creation_date),
 	m_user_limit(0),
@@ -226,40 +216,37 @@ void Channel::set_topic(const std::string &topic, const User& user)
 
 void Channel::add_user(User &user)
 {
-	m_users[&user] = UserPermissions();
+	if (m_users.insert(user))
+		m_nicknames.insert(user);
+	else
+		get_user_perms_reference(m_users.iterator_to(user)) = UserPermissions();
 }
 
 void Channel::remove_user(User &user)
 {
-	UserIterator user_it = m_users.find(&user);
-	if (has_user(user_it))
-		m_users.erase(user_it);
+	if (m_users.remove(user))
+		m_nicknames.remove(user);
 }
 
 void Channel::remove_user(const std::string &user_nickname)
 {
 	UserIterator user_it = find_user(user_nickname);
 	if (has_user(user_it))
-		m_users.erase(user_it);
+		remove_user(get_user_reference(user_it));
 	else CORE_TRACE_IRC_ERR("Failed to remove [%s] from the user list of channel [%s] because it was not present.", user_nickname.c_str(), m_name.c_str());
 }
 
-bool Channel::has_user(User &user) const
+bool Channel::has_user(const User &user) const
 {
-	return m_users.find(&user) != m_users.end();
+	return m_users.contains(user);
 }
 
 bool Channel::has_user(const std::string &user_nickname) const
 {
-	std::string user_nickname_upper = to_upper(user_nickname);
-	for (ConstUserIterator user_it = m_users.begin(); user_it != m_users.end(); user_it++) {
-		if (get_user_reference(user_it).nickname_upper() == user_nickname_upper)
-			return true;
-	}
-	return false;
+	return m_nicknames.find(user_nickname) != NULL;
 }
 
-bool Channel::has_user(const UserMap::iterator &user_it) const
+bool Channel::has_user(const ConstUserIterator &user_it) const
 {
 	return user_it != m_users.end();
 }
@@ -271,7 +258,7 @@ void Channel::set_user_operator_permission(User& user, bool value)
 		return;
 	}
 
-	m_users.at(&user).set_is_operator(value);
+	get_user_perms_reference(m_users.iterator_to(user)).set_is_operator(value);
 }
 
 void Channel::set_user_operator_permission(User &user, const std::string &user_nickname, bool value)
@@ -282,7 +269,7 @@ void Channel::set_user_operator_permission(User &user, const std::string &user_n
 		return;
 	}
 
-	UserPermissions& target = find_user(user_nickname)->second;
+	UserPermissions& target = get_user_perms_reference(find_user(user_nickname));
 	if (target.is_operator() != value) {
 		target.set_is_operator(value);
 		if (value)
@@ -299,7 +286,7 @@ void Channel::set_user_voice_permission(User& user, bool value)
 		return;
 	}
 
-	m_users.at(&user).set_has_voice(value);
+	get_user_perms_reference(m_users.iterator_to(user)).set_has_voice(value);
 }
 
 void Channel::set_user_voice_permission(User &user, const std::string &user_nickname, bool value)
@@ -310,7 +297,7 @@ void Channel::set_user_voice_permission(User &user, const std::string &user_nick
 		return;
 	}
 
-	UserPermissions& target = find_user(user_nickname)->second;
+	UserPermissions& target = get_user_perms_reference(find_user(user_nickname));
 	if (target.has_voice() != value) {
 		target.set_has_voice(value);
 		if (value)
@@ -322,27 +309,24 @@ void Channel::set_user_voice_permission(User &user, const std::string &user_nick
 
 Channel::UserIterator Channel::find_user(const std::string &user_nickname)
 {
-	std::string user_nickname_upper = to_upper(user_nickname);
-	for (UserIterator user_it = m_users.begin(); user_it != m_users.end(); user_it++) {
-		if (get_user_reference(user_it).nickname_upper() == user_nickname_upper)
-			return user_it;
-	}
-	return m_users.end();
+	User *user = m_nicknames.find(user_nickname);
+	if (!user)
+		return m_users.end();
+	return m_users.iterator_to(*user);
 }
 
 Channel::ConstUserIterator Channel::find_user(const std::string &user_nickname) const
 {
-	std::string user_nickname_upper = to_upper(user_nickname);
-	for (ConstUserIterator user_it = m_users.begin(); user_it != m_users.end(); user_it++) {
-		if (get_user_reference(user_it).nickname_upper() == user_nickname_upper)
-			return user_it;
-	}
-	return m_users.end();
+	User *user = m_nicknames.find(user_nickname);
+	if (!user)
+		return m_users.end();
+	return m_users.iterator_to(*user);
 }
 
 bool Channel::is_user_operator(const User &user) const
 {
-	return is_user_operator(user.nickname());
+	ConstUserIterator user_it = m_users.iterator_to(user);
+	return has_user(user_it) && get_user_perms_reference(user_it).is_operator();
 }
 
 bool Channel::is_user_operator(const std::string &user_nickname) const
@@ -355,7 +339,8 @@ bool Channel::is_user_operator(const std::string &user_nickname) const
 
 bool Channel::is_user_has_voice(const User &user) const
 {
-	return is_user_has_voice(user.nickname());
+	ConstUserIterator user_it = m_users.iterator_to(user);
+	return has_user(user_it) && get_user_perms_reference(user_it).has_voice();
 }
 
 bool Channel::is_user_has_voice(const std::string &user_nickname) const
@@ -404,96 +389,51 @@ void Channel::broadcast_topic(User &user_to_avoid)
 	}
 }
 
-bool Channel::is_user_invited_or_exempted(User &user)
-{
-	return is_user_invited_or_exempted(user.nickname());
-}
-
-bool Channel::is_user_invited_or_exempted(const std::string &user_nickname)
+bool Channel::is_user_invited_or_exempted(const User &user) const
 {
-	if (is_user_in_invite_list(user_nickname))
+	if (is_user_in_invite_list(user))
 		return true;
 
-	if (is_user_in_invite_list_exemptions(user_nickname))
+	if (is_user_in_invite_list_exemptions(user))
 		return true;
 
 	return false;
 }
 
-bool Channel::is_user_banned(User &user)
+bool Channel::is_user_banned(const User &user) const
 {
-	return is_user_banned(user.nickname());
-}
-
-bool Channel::is_user_banned(const std::string &user_nickname)
-{
-	if (is_user_in_ban_exemptions(user_nickname))
+	if (is_user_in_ban_exemptions(user))
 		return false;
 
-	if (is_user_in_banlist(user_nickname))
+	if (is_user_in_banlist(user))
 		return true;
 
 	return false;
 }
 
-bool Channel::is_user_in_invite_list(User &user)
+bool Channel::is_user_in_invite_list(const User &user) const
 {
 	return is_user_in_invite_list(user.nickname());
 }
 
-bool Channel::is_user_in_invite_list(const std::string &user_nickname)
+bool Channel::is_user_in_invite_list(const std::string &user_nickname) const
 {
-	std::string user_nickname_upper = to_upper(user_nickname);
-	for (ConstNicknameIterator nickname_it = m_invite_list.begin(); nickname_it != m_invite_list.end(); nickname_it++) {
-		if (user_nickname_upper == to_upper(*nickname_it))
-			return true;
-	}
-	return false;
+	return m_invite_list.matches(user_nickname);
 }
 
-bool Channel::is_user_in_invite_list_exemptions(User &user)
+bool Channel::is_user_in_invite_list_exemptions(const User &user) const
 {
-	return is_user_in_invite_list_exemptions(user.nickname());
+	return m_invite_exemptions.matches(user.source());
 }
 
-bool Channel::is_user_in_invite_list_exemptions(const std::string &user_nickname)
+bool Channel::is_user_in_banlist(const User &user) const
 {
-	std::string user_nickname_upper = to_upper(user_nickname);
-	for (ConstNicknameIterator nickname_it = m_invite_exemptions.begin(); nickname_it != m_invite_exemptions.end(); nickname_it++) {
-		if (user_nickname_upper == to_upper(*nickname_it))
-			return true;
-	}
-	return false;
-}
-
-bool Channel::is_user_in_banlist(User &user)
-{
-	return is_user_in_banlist(user.nickname());
-}
-
-bool Channel::is_user_in_banlist(const std::string &user_nickname)
-{
-	std::string user_nickname_upper = to_upper(user_nickname);
-	for (ConstNicknameIterator nickname_it = m_ban_list.begin(); nickname_it != m_ban_list.end(); nickname_it++) {
-		if (user_nickname_upper == to_upper(*nickname_it))
-			return true;
-	}
-	return false;
+	return m_ban_list.matches(user.source());
 }
 
-bool Channel::is_user_in_ban_exemptions(User &user)
+bool Channel::is_user_in_ban_exemptions(const User &user) const
 {
-	return is_user_in_ban_exemptions(user.nickname());
-}
-
-bool Channel::is_user_in_ban_exemptions(const std::string &user_nickname)
-{
-	std::string user_nickname_upper = to_upper(user_nickname);
-	for (ConstNicknameIterator nickname_it = m_ban_exemptions.begin(); nickname_it != m_ban_exemptions.end(); nickname_it++) {
-		if (user_nickname_upper == to_upper(*nickname_it))
-			return true;
-	}
-	return false;
+	return m_ban_exemptions.matches(user.source());
 }
 
 void Channel::add_to_banlist(const User &user)
@@ -501,22 +441,20 @@ void Channel::add_to_banlist(const User &user)
 	add_to_banlist(user, user.nickname());
 }
 
-void Channel::add_to_banlist(const User &user, const std::string &user_nickname)
+void Channel::add_to_banlist(const User &user, const std::string &user_mask)
 {
+	std::string mask = Hostmask::normalize(user_mask);
+
 	if (m_ban_list.size() >= Server::max_user_lists()) {
-		CORE_TRACE_IRC_ERR("Failed to add [%s] to the ban exemption list of channel [%s] because the list is full.", user_nickname.c_str(), m_name.c_str());
+		CORE_TRACE_IRC_ERR("Failed to add [%s] to the ban exemption list of channel [%s] because the list is full.", mask.c_str(), m_name.c_str());
 		return;
 	}
 
-	std::string user_nickname_upper = to_upper(user_nickname);
-	for (ConstNicknameIterator nickname_it = m_ban_list.begin(); nickname_it != m_ban_list.end(); nickname_it++) {
-		if (user_nickname_upper == to_upper(*nickname_it)) {
-			CORE_TRACE_IRC_ERR("Failed to add [%s] to the ban list of channel [%s] because it was already present.", user_nickname.c_str(), m_name.c_str());
-			return;
-		}
+	if (!m_ban_list.add(mask)) {
+		CORE_TRACE_IRC_ERR("Failed to add [%s] to the ban list of channel [%s] because it was already present.", mask.c_str(), m_name.c_str());
+		return;
 	}
-	m_ban_list.push_back(user_nickname);
-	Server::broadcast_to_channel(*this, RPL_MODE_CHANNEL(user, name(), "+b " + user_nickname));
+	Server::broadcast_to_channel(*this, RPL_MODE_CHANNEL(user, name(), "+b " + mask));
 }
 
 void Channel::remove_from_banlist(const User &user)
@@ -524,17 +462,15 @@ void Channel::remove_from_banlist(const User &user)
 	remove_from_banlist(user, user.nickname());
 }
 
-void Channel::remove_from_banlist(const User &user, const std::string &user_nickname)
+void Channel::remove_from_banlist(const User &user, const std::string &user_mask)
 {
-	std::string user_nickname_upper = to_upper(user_nickname);
-	for (NicknameIterator entry = m_ban_list.begin(); entry != m_ban_list.end(); entry++) {
-		if (user_nickname_upper == to_upper(*entry)) {
-			m_ban_list.erase(entry);
-			Server::broadcast_to_channel(*this, RPL_MODE_CHANNEL(user, name(), "-b " + user_nickname));
-			return;
-		}
+	std::string mask = Hostmask::normalize(user_mask);
+
+	if (!m_ban_list.remove(mask)) {
+		CORE_TRACE_IRC_ERR("Failed to remove [%s] from the ban list of channel [%s] because it was not present.", mask.c_str(), m_name.c_str());
+		return;
 	}
-	CORE_TRACE_IRC_ERR("Failed to remove [%s] from the ban list of channel [%s] because it was not present.", user_nickname.c_str(), m_name.c_str());
+	Server::broadcast_to_channel(*this, RPL_MODE_CHANNEL(user, name(), "-b " + mask));
 }
 
 void Channel::add_to_ban_exemptions(const User &user)
@@ -542,22 +478,20 @@ void Channel::add_to_ban_exemptions(const User &user)
 	add_to_ban_exemptions(user, user.nickname());
 }
 
-void Channel::add_to_ban_exemptions(const User &user, const std::string &user_nickname)
+void Channel::add_to_ban_exemptions(const User &user, const std::string &user_mask)
 {
+	std::string mask = Hostmask::normalize(user_mask);
+
 	if (m_ban_exemptions.size() >= Server::max_user_lists()) {
-		CORE_TRACE_IRC_ERR("Failed to add [%s] to the ban exemption list of channel [%s] because the list is full.", user_nickname.c_str(), m_name.c_str());
+		CORE_TRACE_IRC_ERR("Failed to add [%s] to the ban exemption list of channel [%s] because the list is full.", mask.c_str(), m_name.c_str());
 		return;
 	}
 
-	std::string user_nickname_upper = to_upper(user_nickname);
-	for (ConstNicknameIterator nickname_it = m_ban_exemptions.begin(); nickname_it != m_ban_exemptions.end(); nickname_it++) {
-		if (user_nickname_upper == to_upper(*nickname_it)) {
-			CORE_TRACE_IRC_ERR("Failed to add [%s] to the ban exemption list of channel [%s] because it was already present.", user_nickname.c_str(), m_name.c_str());
-			return;
-		}
+	if (!m_ban_exemptions.add(mask)) {
+		CORE_TRACE_IRC_ERR("Failed to add [%s] to the ban exemption list of channel [%s] because it was already present.", mask.c_str(), m_name.c_str());
+		return;
 	}
-	m_ban_exemptions.push_back(user_nickname);
-	Server::broadcast_to_channel(*this, RPL_MODE_CHANNEL(user, name(), "+e " + user_nickname));
+	Server::broadcast_to_channel(*this, RPL_MODE_CHANNEL(user, name(), "+e " + mask));
 }
 
 void Channel::remove_from_ban_exemptions(const User &user)
@@ -565,17 +499,15 @@ void Channel::remove_from_ban_exemptions(const User &user)
 	remove_from_ban_exemptions(user, user.nickname());
 }
 
-void Channel::remove_from_ban_exemptions(const User &user, const std::string &user_nickname)
+void Channel::remove_from_ban_exemptions(const User &user, const std::string &user_mask)
 {
-	std::string user_nickname_upper = to_upper(user_nickname);
-	for (NicknameIterator entry = m_ban_exemptions.begin(); entry != m_ban_exemptions.end(); entry++) {
-		if (user_nickname_upper == to_upper(*entry)) {
-			m_ban_exemptions.erase(entry);
-			Server::broadcast_to_channel(*this, RPL_MODE_CHANNEL(user, name(), "-e " + user_nickname));
-			return;
-		}
+	std::string mask = Hostmask::normalize(user_mask);
+
+	if (!m_ban_exemptions.remove(mask)) {
+		CORE_TRACE_IRC_ERR("Failed to remove [%s] from the ban exemption list of channel [%s] because it was not present.", mask.c_str(), m_name.c_str());
+		return;
 	}
-	CORE_TRACE_IRC_ERR("Failed to remove [%s] from the ban exemption list of channel [%s] because it was not present.", user_nickname.c_str(), m_name.c_str());
+	Server::broadcast_to_channel(*this, RPL_MODE_CHANNEL(user, name(), "-e " + mask));
 }
 
 void Channel::add_to_invitelist(const User &user)
@@ -585,14 +517,8 @@ void Channel::add_to_invitelist(const User &user)
 
 void Channel::add_to_invitelist(const std::string &user_nickname)
 {
-	std::string user_nickname_upper = to_upper(user_nickname);
-	for (ConstNicknameIterator nickname_it = m_invite_list.begin(); nickname_it != m_invite_list.end(); nickname_it++) {
-		if (user_nickname_upper == to_upper(*nickname_it)) {
-			CORE_TRACE_IRC_ERR("Failed to add [%s] to the invite list of channel [%s] because it was already present.", user_nickname.c_str(), m_name.c_str());
-			return;
-		}
-	}
-	m_invite_list.push_back(user_nickname);
+	if (!m_invite_list.add(user_nickname))
+		CORE_TRACE_IRC_ERR("Failed to add [%s] to the invite list of channel [%s] because it was already present.", user_nickname.c_str(), m_name.c_str());
 }
 
 void Channel::remove_from_invitelist(const User &user)
@@ -602,14 +528,8 @@ void Channel::remove_from_invitelist(const User &user)
 
 void Channel::remove_from_invitelist(const std::string &user_nickname)
 {
-	std::string user_nickname_upper = to_upper(user_nickname);
-	for (NicknameIterator entry = m_invite_list.begin(); entry != m_invite_list.end(); entry++) {
-		if (user_nickname_upper == to_upper(*entry)) {
-			m_invite_list.erase(entry);
-			return;
-		}
-	}
-	CORE_TRACE_IRC_ERR("Failed to remove [%s] from the invite list of channel [%s] because it was not present.", user_nickname.c_str(), m_name.c_str());
+	if (!m_invite_list.remove(user_nickname))
+		CORE_TRACE_IRC_ERR("Failed to remove [%s] from the invite list of channel [%s] because it was not present.", user_nickname.c_str(), m_name.c_str());
 }
 
 void Channel::add_to_invite_list_exemptions(const User &user)
@@ -617,22 +537,20 @@ void Channel::add_to_invite_list_exemptions(const User &user)
 	add_to_invite_list_exemptions(user, user.nickname());
 }
 
-void Channel::add_to_invite_list_exemptions(const User &user, const std::string &user_nickname)
+void Channel::add_to_invite_list_exemptions(const User &user, const std::string &user_mask)
 {
-	if (m_invite_list.size() >= Server::max_user_lists()) {
-		CORE_TRACE_IRC_ERR("Failed to add [%s] to the ban exemption list of channel [%s] because the list is full.", user_nickname.c_str(), m_name.c_str());
+	std::string mask = Hostmask::normalize(user_mask);
+
+	if (m_invite_exemptions.size() >= Server::max_user_lists()) {
+		CORE_TRACE_IRC_ERR("Failed to add [%s] to the invite exemption list of channel [%s] because the list is full.", mask.c_str(), m_name.c_str());
 		return;
 	}
 
-	std::string user_nickname_upper = to_upper(user_nickname);
-	for (ConstNicknameIterator nickname_it = m_invite_exemptions.begin(); nickname_it != m_invite_exemptions.end(); nickname_it++) {
-		if (user_nickname_upper == to_upper(*nickname_it)) {
-			CORE_TRACE_IRC_ERR("Failed to add [%s] to the invite exemption list of channel [%s] because it was already present.", user_nickname.c_str(), m_name.c_str());
-			return;
-		}
+	if (!m_invite_exemptions.add(mask)) {
+		CORE_TRACE_IRC_ERR("Failed to add [%s] to the invite exemption list of channel [%s] because it was already present.", mask.c_str(), m_name.c_str());
+		return;
 	}
-	m_invite_exemptions.push_back(user_nickname);
-	Server::broadcast_to_channel(*this, RPL_MODE_CHANNEL(user, name(), "+I " + user_nickname));
+	Server::broadcast_to_channel(*this, RPL_MODE_CHANNEL(user, name(), "+I " + mask));
 }
 
 void Channel::remove_from_invite_list_exemptions(const User &user)
@@ -640,17 +558,15 @@ void Channel::remove_from_invite_list_exemptions(const User &user)
 	remove_from_invite_list_exemptions(user, user.nickname());
 }
 
-void Channel::remove_from_invite_list_exemptions(const User &user, const std::string &user_nickname)
+void Channel::remove_from_invite_list_exemptions(const User &user, const std::string &user_mask)
 {
-	std::string user_nickname_upper = to_upper(user_nickname);
-	for (NicknameIterator entry = m_invite_exemptions.begin(); entry != m_invite_exemptions.end(); entry++) {
-		if (user_nickname_upper == to_upper(*entry)) {
-			m_invite_exemptions.erase(entry);
-			Server::broadcast_to_channel(*this, RPL_MODE_CHANNEL(user, name(), "-I " + user_nickname));
-			return;
-		}
+	std::string mask = Hostmask::normalize(user_mask);
+
+	if (!m_invite_exemptions.remove(mask)) {
+		CORE_TRACE_IRC_ERR("Failed to remove [%s] from the invite list of channel [%s] because it was not present.", mask.c_str(), m_name.c_str());
+		return;
 	}
-	CORE_TRACE_IRC_ERR("Failed to remove [%s] from the invite list of channel [%s] because it was not present.", user_nickname.c_str(), m_name.c_str());
+	Server::broadcast_to_channel(*this, RPL_MODE_CHANNEL(user, name(), "-I " + mask));
 }
 
 bool Channel::is_name_valid(const std::string &channel_name)
@@ -676,7 +592,7 @@ bool Channel::is_channel_type_char(char c)
 
 bool Channel::is_user_allowed_to_send_messages(const User &user)
 {
-	if (is_user_banned(user.nickname()))
+	if (is_user_banned(user))
 		return false;
 
 	UserIterator user_it = find_user(user.nickname());
@@ -692,7 +608,7 @@ bool Channel::is_user_allowed_to_send_messages(const User &user)
 	return true;
 }
 
-std::string Channel::get_user_prefix(const std::string& channel_name, const User& user) const
+const char *Channel::get_user_prefix(const std::string& channel_name, const User& user) const
 {
 	Server::ChannelIterator channel_it = Server::find_channel(channel_name);
 	if (!Server::channel_exists(channel_it))
@@ -700,14 +616,10 @@ std::string Channel::get_user_prefix(const std::string& channel_name, const User
 	return "";
 }
 
-std::string Channel::get_user_prefix(const User& user) const
+const char *Channel::get_user_prefix(const User& user) const
 {
-	std::string flags;
-
-	if (is_user_operator(user))
-		flags += "@";
-	if (is_user_has_voice(user))
-		flags += "+";
-
-	return flags;
+	ConstUserIterator user_it = m_users.iterator_to(user);
+	if (!has_user(user_it))
+		return "";
+	return get_user_perms_reference(user_it).prefixes();
 }
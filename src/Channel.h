@@ -20,41 +20,20 @@
 #include <ctime>
 #include "Command.h"
 #include "Mode.h"
+#include "NicknameIndex.h"
+#include "ChannelMembers.h"
+#include "MaskList.h"
 
 class User;
 
 class Channel
 {
 public:
-	/// Types
-	struct UserPermissions
-	{
-		explicit UserPermissions();
-
-		std::string get_highest_prefix() const;
-
-		void set_is_operator(bool new_value)	{ m_is_operator = new_value; };
-		void set_has_voice(bool new_value)		{ m_has_voice = new_value; };
-
-		bool is_operator()	const				{ return m_is_operator; };
-		bool has_voice()	const				{ return m_has_voice; };
-
-	private:
-		bool m_is_operator;
-		bool m_has_voice;
-	};
-
 	explicit Channel(User& user, const std::string& name);
 
 	/// Typedefs
-private:
-	typedef std::map<User*, UserPermissions>	UserMap;
-	typedef std::vector<std::string>			NicknameVector;
-public:
-	typedef UserMap::iterator					UserIterator;
-	typedef UserMap::const_iterator				ConstUserIterator;
-	typedef NicknameVector::iterator			NicknameIterator;
-	typedef NicknameVector::const_iterator		ConstNicknameIterator;
+	typedef ChannelMembers::iterator			UserIterator;
+	typedef ChannelMembers::const_iterator		ConstUserIterator;
 
 	/// Channel related checks
 	static bool is_name_valid(const std::string& channel_name);
@@ -80,9 +59,14 @@ public:
 	void remove_user(User& user);
 	void remove_user(const std::string& user_nickname);
 
-	bool has_user(User& user) const;
+	/// The nickname index is keyed by the current nickname: a user must be
+	///  unindexed before its nickname changes and indexed back afterwards
+	void unindex_user(const User& user)	{ m_nicknames.remove(user); }
+	void index_user(User& user)			{ m_nicknames.insert(user); }
+
+	bool has_user(const User& user) const;
 	bool has_user(const std::string& user_nickname) const;
-	bool has_user(const UserIterator& user_it) const;
+	bool has_user(const ConstUserIterator& user_it) const;
 
 	void set_user_operator_permission(User& user, bool value);
 	void set_user_operator_permission(User &user, const std::string &user_nickname, bool value);
@@ -93,44 +77,40 @@ public:
 	bool update_mode(User &user, const std::vector<ModeParam> &mode_params);
 
 	/// Entry restrictions
-	bool is_user_banned(User& user);
-	bool is_user_banned(const std::string& user_nickname);
-	bool is_user_invited_or_exempted(User& user);
-	bool is_user_invited_or_exempted(const std::string& user_nickname);
+	/// The +b, +e and +I masks are completed to nick!user@host and matched
+	///  against User::source(), the invite list only holds nicknames
+	bool is_user_banned(const User& user) const;
+	bool is_user_invited_or_exempted(const User& user) const;
 
-	bool is_user_in_invite_list(User& user);
-	bool is_user_in_invite_list(const std::string& user_nickname);
+	bool is_user_in_invite_list(const User& user) const;
+	bool is_user_in_invite_list(const std::string& user_nickname) const;
 	void add_to_invitelist(const User& user);
 	void add_to_invitelist(const std::string &user_nickname);
 	void remove_from_invitelist(const User& user);
 	void remove_from_invitelist(const std::string &user_nickname);
 
-	bool is_user_in_banlist(User& user);
-	bool is_user_in_banlist(const std::string& user_nickname);
+	bool is_user_in_banlist(const User& user) const;
 	void add_to_banlist(const User& user);
-	void add_to_banlist(const User &user, const std::string &user_nickname);
+	void add_to_banlist(const User &user, const std::string &user_mask);
 	void remove_from_banlist(const User& user);
-	void remove_from_banlist(const User &user, const std::string &user_nickname);
+	void remove_from_banlist(const User &user, const std::string &user_mask);
 
-	bool is_user_in_ban_exemptions(User& user);
-	bool is_user_in_ban_exemptions(const std::string& user_nickname);
+	bool is_user_in_ban_exemptions(const User& user) const;
 	void add_to_ban_exemptions(const User& user);
-	void add_to_ban_exemptions(const User &user, const std::string &user_nickname);
+	void add_to_ban_exemptions(const User &user, const std::string &user_mask);
 	void remove_from_ban_exemptions(const User& user);
-	void remove_from_ban_exemptions(const User &user, const std::string &user_nickname);
+	void remove_from_ban_exemptions(const User &user, const std::string &user_mask);
 
-	bool is_user_in_invite_list_exemptions(User& user);
-	bool is_user_in_invite_list_exemptions(const std::string& user_nickname);
+	bool is_user_in_invite_list_exemptions(const User& user) const;
 	void add_to_invite_list_exemptions(const User& user);
-	void add_to_invite_list_exemptions(const User &user, const std::string &user_nickname);
+	void add_to_invite_list_exemptions(const User &user, const std::string &user_mask);
 	void remove_from_invite_list_exemptions(const User& user);
-	void remove_from_invite_list_exemptions(const User &user, const std::string &user_nickname);
+	void remove_from_invite_list_exemptions(const User &user, const std::string &user_mask);
 
 	bool is_user_allowed_to_send_messages(const User& user);
 
 	/// Getters
 	const	std::string&			name()								const { return m_name; }
-	const	std::string&			name_to_upper()						const { return m_name_to_upper; }
 	const	std::time_t&			creation_date()						const { return m_creation_date; }
 			std::string				creation_date_as_str()				const { return to_string(creation_date()); }
 	const	std::string&			topic()								const { return m_topic; }
@@ -143,14 +123,14 @@ public:
 	size_t							user_count()					const { return m_users.size(); }
 	std::string						user_count_as_str()				const { return to_string(m_users.size()); }
 	size_t							user_limit()					const { return m_user_limit; }
-	const UserMap&					users()							const { return m_users; }
-	UserMap&						users()								  { return m_users; }
+	const ChannelMembers&			users()							const { return m_users; }
+	ChannelMembers&					users()								  { return m_users; }
 
 	const std::string&				key()							const { return m_key; }
-	const std::vector<std::string>&	invite_list()					const { return m_invite_list; }
-	const std::vector<std::string>&	invite_exemptions()				const { return m_invite_exemptions; }
-	const std::vector<std::string>&	ban_list()						const { return m_ban_list; }
-	const std::vector<std::string>&	ban_exemptions()				const { return m_ban_exemptions; }
+	const std::vector<std::string>&	invite_list()					const { return m_invite_list.entries(); }
+	const std::vector<std::string>&	invite_exemptions()				const { return m_invite_exemptions.entries(); }
+	const std::vector<std::string>&	ban_list()						const { return m_ban_list.entries(); }
+	const std::vector<std::string>&	ban_exemptions()				const { return m_ban_exemptions.entries(); }
 	std::string						get_modes_as_str(User& user)	const;
 
 	bool	is_user_operator(const User& user) const;
@@ -166,13 +146,12 @@ public:
 	bool	is_topic_protected()	const { return m_is_topic_protected; }
 	bool	no_outside_messages()	const { return m_no_outside_messages; }
 
-	std::string	get_user_prefix(const std::string& channel_name, const User& user) const;
-	std::string	get_user_prefix(const User& user) const;
+	const char	*get_user_prefix(const std::string& channel_name, const User& user) const;
+	const char	*get_user_prefix(const User& user) const;
 
 private:
 	/// Channel information
 	std::string	m_name;
-	std::string	m_name_to_upper;
 	std::time_t	m_creation_date;
 	char		m_type;
 	std::string	m_topic;
@@ -180,15 +159,16 @@ private:
 	std::time_t	m_topic_modification_date;
 
 	/// Entry restrictions
-	NicknameVector	m_ban_list;
-	NicknameVector	m_ban_exemptions;
-	NicknameVector	m_invite_list;
-	NicknameVector	m_invite_exemptions;
+	MaskList		m_ban_list;
+	MaskList		m_ban_exemptions;
+	MaskList		m_invite_list;
+	MaskList		m_invite_exemptions;
 	std::string 	m_key;
 
 	/// Users
-	size_t	m_user_limit;
-	UserMap	m_users;
+	size_t			m_user_limit;
+	ChannelMembers	m_users;
+	NicknameIndex	m_nicknames;
 
 	/// Modes
 	bool	m_is_user_limited;			// +l
@@ -200,10 +180,10 @@ private:
 	bool	m_no_outside_messages;		// +n
 };
 
-inline const User&						get_user_reference(const Channel::ConstUserIterator& user_it)		{ return *(user_it->first); }
-inline       User&						get_user_reference(const Channel::UserIterator& user_it)			{ return *(user_it->first); }
+inline const User&				get_user_reference(const Channel::ConstUserIterator& user_it)		{ return user_it.user(); }
+inline       User&				get_user_reference(const Channel::UserIterator& user_it)			{ return user_it.user(); }
 
-inline       Channel::UserPermissions&	get_user_perms_reference(const Channel::UserIterator& user_it)		{ return user_it->second; }
-inline const Channel::UserPermissions&	get_user_perms_reference(const Channel::ConstUserIterator& user_it)	{ return user_it->second; }
+inline       UserPermissions&	get_user_perms_reference(const Channel::UserIterator& user_it)		{ return user_it.permissions(); }
+inline const UserPermissions&	get_user_perms_reference(const Channel::ConstUserIterator& user_it)	{ return user_it.permissions(); }
 
 #endif //CHANNEL_H
@@ -0,0 +1,130 @@
+//
+// Created by nathan on 4/9/23.
+//
+
+#include "ChannelMembers.h"
+#include "Channel.h"
+#include "User.h"
+
+// Small enough for the many channels with a few members
+#define CHANNEL_MEMBERS_MIN_SLOTS 8
+
+const std::size_t ChannelMembers::npos = static_cast<std::size_t>(-1);
+
+#define V CHANNEL_USER_PREFIX_VOICE
+#define H CHANNEL_USER_PREFIX_HALFOP
+#define O CHANNEL_USER_PREFIX_OPERATOR
+#define A CHANNEL_USER_PREFIX_PROTECTED
+#define Q CHANNEL_USER_PREFIX_FOUNDER
+
+// Indexed by the bit of each permission
+static const char *const highest_prefixes[] = { V, H, O, A, Q };
+
+// Indexed by the permission mask
+static const char *const all_prefixes[] = {
+	"",		V,		H,		H V,		O,		O V,		O H,		O H V,
+	A,		A V,	A H,	A H V,		A O,	A O V,		A O H,		A O H V,
+	Q,		Q V,	Q H,	Q H V,		Q O,	Q O V,		Q O H,		Q O H V,
+	Q A,	Q A V,	Q A H,	Q A H V,	Q A O,	Q A O V,	Q A O H,	Q A O H V
+};
+
+#undef V
+#undef H
+#undef O
+#undef A
+#undef Q
+
+const char *UserPermissions::highest_prefix() const
+{
+	if (m_mask == 0)
+		return "";
+
+	std::size_t bit = 0;
+	for (unsigned char mask = m_mask; mask > 1; mask = static_cast<unsigned char>(mask >> 1))
+		bit++;
+	return highest_prefixes[bit];
+}
+
+const char *UserPermissions::prefixes() const
+{
+	return all_prefixes[m_mask];
+}
+
+struct ChannelMembers::SameUser
+{
+	explicit SameUser(const User *searched_user) : user(searched_user) {}
+
+	bool operator()(const Slot& slot) const { return slot.user == user; }
+
+	const User	*user;
+};
+
+ChannelMembers::ChannelMembers() : m_slots(CHANNEL_MEMBERS_MIN_SLOTS)
+{
+}
+
+bool ChannelMembers::insert(User& user, const UserPermissions& permissions)
+{
+	if (contains(user))
+		return false;
+
+	Slot slot = { &user, m_users.size() };
+	m_slots.insert(slot);
+	m_users.push_back(&user);
+	m_permissions.push_back(permissions);
+	return true;
+}
+
+bool ChannelMembers::remove(const User& user)
+{
+	std::size_t slot = find_slot(&user);
+	if (slot == npos)
+		return false;
+	std::size_t position = m_slots[slot].position;
+	m_slots.remove(slot);
+
+	// Move the last member into the freed position
+	std::size_t last_position = m_users.size() - 1;
+	if (position != last_position) {
+		m_users[position] = m_users[last_position];
+		m_permissions[position] = m_permissions[last_position];
+		m_slots[find_slot(m_users[position])].position = position;
+	}
+
+	m_users.pop_back();
+	m_permissions.pop_back();
+	return true;
+}
+
+std::size_t ChannelMembers::find(const User& user) const
+{
+	std::size_t slot = find_slot(&user);
+	return slot == npos ? npos : m_slots[slot].position;
+}
+
+ChannelMembers::iterator ChannelMembers::iterator_to(const User& user)
+{
+	std::size_t position = find(user);
+	return position == npos ? end() : iterator(this, position);
+}
+
+ChannelMembers::const_iterator ChannelMembers::iterator_to(const User& user) const
+{
+	std::size_t position = find(user);
+	return position == npos ? end() : const_iterator(this, position);
+}
+
+std::size_t ChannelMembers::hash(const User *user)
+{
+	// The low bits of an address are always the same, mix them with the others
+	std::size_t h = reinterpret_cast<std::size_t>(user);
+	h ^= h >> 4;
+	h *= static_cast<std::size_t>(0x9E3779B97F4A7C15ULL);
+	return h ^ (h >> (sizeof(std::size_t) * 4));
+}
+
+std::size_t ChannelMembers::find_slot(const User *user) const
+{
+	std::size_t slot = m_slots.find(hash(user), SameUser(user));
+	return slot == m_slots.npos ? npos : slot;
+}
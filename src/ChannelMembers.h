@@ -0,0 +1,141 @@
+//
+// Created by nathan on 4/9/23.
+//
+
+#ifndef CHANNELMEMBERS_H
+#define CHANNELMEMBERS_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include "HashSlots.h"
+
+class User;
+
+/// Modes a user can have in a channel, by increasing rank
+enum ChannelPermission
+{
+	PERMISSION_VOICE		= 1 << 0,	// +v
+	PERMISSION_HALFOP		= 1 << 1,	// +h
+	PERMISSION_OPERATOR		= 1 << 2,	// +o
+	PERMISSION_PROTECTED	= 1 << 3,	// +a
+	PERMISSION_FOUNDER		= 1 << 4	// +q
+};
+
+/// Modes a user has in a channel, as a mask of ChannelPermission
+struct UserPermissions
+{
+	UserPermissions() : m_mask(0) {}
+
+	/// Prefix of the highest permission, or all of them by decreasing rank
+	///  for multi-prefix. Both come from constant tables.
+	const char	*highest_prefix()	const;
+	const char	*prefixes()			const;
+	const char	*prefixes(bool multi_prefix)	const { return multi_prefix ? prefixes() : highest_prefix(); }
+
+	void set(ChannelPermission permission, bool value) {
+		m_mask = static_cast<unsigned char>(value ? m_mask | permission : m_mask & ~permission);
+	}
+	void set_is_operator(bool new_value)	{ set(PERMISSION_OPERATOR, new_value); };
+	void set_has_voice(bool new_value)		{ set(PERMISSION_VOICE, new_value); };
+
+	bool			has(ChannelPermission permission)	const { return (m_mask & permission) != 0; }
+	bool			is_operator()	const				{ return has(PERMISSION_OPERATOR); };
+	bool			has_voice()		const				{ return has(PERMISSION_VOICE); };
+	unsigned char	mask()			const				{ return m_mask; }
+
+private:
+	unsigned char	m_mask;
+};
+
+// Members of a channel, stored as two dense arrays: the users and their
+//  permission masks, so that going through the members is a linear scan.
+//  The position of each user is kept in a hash table keyed by its address,
+//  and a removed member is replaced by the last one, so the order isn't kept.
+class ChannelMembers
+{
+public:
+	template<typename Members, typename UserType, typename PermissionsType>
+	class basic_iterator
+	{
+	public:
+		basic_iterator() : m_members(NULL), m_position(0) {}
+		basic_iterator(Members *members, std::size_t position) : m_members(members), m_position(position) {}
+		// Allows converting an iterator to a const_iterator
+		template<typename OtherMembers, typename OtherUser, typename OtherPermissions>
+		basic_iterator(const basic_iterator<OtherMembers, OtherUser, OtherPermissions>& other) :
+			m_members(other.members()), m_position(other.position()) {}
+
+		UserType&			user()			const { return m_members->user(m_position); }
+		PermissionsType&	permissions()	const { return m_members->permissions(m_position); }
+		Members				*members()		const { return m_members; }
+		std::size_t			position()		const { return m_position; }
+
+		basic_iterator&	operator++()	{ m_position++; return *this; }
+		basic_iterator	operator++(int)	{ basic_iterator old(*this); m_position++; return old; }
+		bool			operator==(const basic_iterator& other) const { return m_position == other.m_position && m_members == other.m_members; }
+		bool			operator!=(const basic_iterator& other) const { return !(*this == other); }
+
+	private:
+		Members		*m_members;
+		std::size_t	m_position;
+	};
+
+	typedef basic_iterator<ChannelMembers, User, UserPermissions>				iterator;
+	typedef basic_iterator<const ChannelMembers, User, const UserPermissions>	const_iterator;
+	typedef std::vector<User*>													UserVector;
+
+	static const std::size_t	npos;
+
+	ChannelMembers();
+
+	/// Returns false if the user already is a member
+	bool		insert(User& user, const UserPermissions& permissions = UserPermissions());
+	bool		remove(const User& user);
+	/// Position of the user in the arrays, or npos
+	std::size_t	find(const User& user)	const;
+	bool		contains(const User& user)	const { return find(user) != npos; }
+
+	iterator		iterator_to(const User& user);
+	const_iterator	iterator_to(const User& user)	const;
+
+	iterator		begin()			{ return iterator(this, 0); }
+	iterator		end()			{ return iterator(this, m_users.size()); }
+	const_iterator	begin()	const	{ return const_iterator(this, 0); }
+	const_iterator	end()	const	{ return const_iterator(this, m_users.size()); }
+
+	std::size_t				size()								const	{ return m_users.size(); }
+	bool					empty()								const	{ return m_users.empty(); }
+	User&					user(std::size_t position)			const	{ return *m_users[position]; }
+	UserPermissions&		permissions(std::size_t position)			{ return m_permissions[position]; }
+	const UserPermissions&	permissions(std::size_t position)	const	{ return m_permissions[position]; }
+	const UserVector&		users()								const	{ return m_users; }
+
+private:
+	struct Slot
+	{
+		const User	*user;
+		std::size_t	position;
+	};
+
+	struct SlotTraits
+	{
+		typedef ChannelMembers::Slot	Slot;
+
+		static Slot			empty_slot()				{ Slot slot = { NULL, 0 }; return slot; }
+		static bool			is_empty(const Slot& slot)	{ return slot.user == NULL; }
+		static std::size_t	hash(const Slot& slot)		{ return ChannelMembers::hash(slot.user); }
+	};
+
+	struct SameUser;
+
+	static std::size_t	hash(const User *user);
+
+	std::size_t	find_slot(const User *user)	const;
+
+	UserVector						m_users;
+	std::vector<UserPermissions>	m_permissions;
+	HashSlots<SlotTraits>			m_slots;
+};
+
+#endif //CHANNELMEMBERS_H
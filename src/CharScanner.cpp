@@ -0,0 +1,170 @@
+//
+// Created by nathan on 4/7/23.
+//
+
+#include "CharScanner.h"
+#include "log.h"
+
+#ifdef CHAR_SCANNER_X86
+# include <immintrin.h>
+#endif
+
+namespace CharScanner
+{
+
+typedef std::size_t (*find_function)(const char *, std::size_t, const char *);
+
+static std::size_t	select_implementation(const char *data, std::size_t size, const char *chars);
+
+static find_function	g_find_first_of = select_implementation;
+static const char		*g_implementation_name = "none";
+
+// Fills needles with the characters to look for, the last one being repeated
+//  so that the vectorized loops always compare against max_chars needles
+static void load_needles(const char *chars, char *needles)
+{
+	std::size_t count = 0;
+	while (count < max_chars && chars[count])
+		count++;
+	if (chars[count] && count == max_chars)
+		CORE_WARN("CharScanner: only the first %llu characters of [%s] are looked for", static_cast<unsigned long long>(max_chars), chars);
+
+	for (std::size_t i = 0; i < max_chars; i++)
+		needles[i] = count ? chars[i < count ? i : count - 1] : '\0';
+}
+
+std::size_t find_first_of(const char *data, std::size_t size, const char *chars)
+{
+	return g_find_first_of(data, size, chars);
+}
+
+static std::size_t scan_scalar(const char *data, std::size_t size, const char *needles)
+{
+	for (std::size_t i = 0; i < size; i++) {
+		char c = data[i];
+		if (c == needles[0] || c == needles[1] || c == needles[2] || c == needles[3])
+			return i;
+	}
+	return npos;
+}
+
+std::size_t find_first_of_scalar(const char *data, std::size_t size, const char *chars)
+{
+	char needles[max_chars];
+	load_needles(chars, needles);
+	return scan_scalar(data, size, needles);
+}
+
+#ifdef CHAR_SCANNER_X86
+
+static std::size_t scan_sse2(const char *data, std::size_t size, const char *needles)
+{
+	const __m128i needle0 = _mm_set1_epi8(needles[0]);
+	const __m128i needle1 = _mm_set1_epi8(needles[1]);
+	const __m128i needle2 = _mm_set1_epi8(needles[2]);
+	const __m128i needle3 = _mm_set1_epi8(needles[3]);
+
+	std::size_t i = 0;
+	for (; i + 16 <= size; i += 16) {
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+		__m128i matches = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(block, needle0), _mm_cmpeq_epi8(block, needle1)),
+			_mm_or_si128(_mm_cmpeq_epi8(block, needle2), _mm_cmpeq_epi8(block, needle3)));
+		int mask = _mm_movemask_epi8(matches);
+		if (mask)
+			return i + static_cast<std::size_t>(__builtin_ctz(static_cast<unsigned int>(mask)));
+	}
+
+	std::size_t tail = scan_scalar(data + i, size - i, needles);
+	return tail == npos ? npos : i + tail;
+}
+
+__attribute__((target("avx2")))
+static std::size_t scan_avx2(const char *data, std::size_t size, const char *needles)
+{
+	const __m256i needle0 = _mm256_set1_epi8(needles[0]);
+	const __m256i needle1 = _mm256_set1_epi8(needles[1]);
+	const __m256i needle2 = _mm256_set1_epi8(needles[2]);
+	const __m256i needle3 = _mm256_set1_epi8(needles[3]);
+
+	std::size_t i = 0;
+	for (; i + 32 <= size; i += 32) {
+		__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+		__m256i matches = _mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(block, needle0), _mm256_cmpeq_epi8(block, needle1)),
+			_mm256_or_si256(_mm256_cmpeq_epi8(block, needle2), _mm256_cmpeq_epi8(block, needle3)));
+		unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(matches));
+		if (mask)
+			return i + static_cast<std::size_t>(__builtin_ctz(mask));
+	}
+
+	// Less than a full AVX2 block left, still done with VEX encoded instructions
+	//  as mixing them with legacy SSE ones is expensive
+	if (i + 16 <= size) {
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+		__m128i matches = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(block, _mm256_castsi256_si128(needle0)), _mm_cmpeq_epi8(block, _mm256_castsi256_si128(needle1))),
+			_mm_or_si128(_mm_cmpeq_epi8(block, _mm256_castsi256_si128(needle2)), _mm_cmpeq_epi8(block, _mm256_castsi256_si128(needle3))));
+		int mask = _mm_movemask_epi8(matches);
+		if (mask)
+			return i + static_cast<std::size_t>(__builtin_ctz(static_cast<unsigned int>(mask)));
+		i += 16;
+	}
+
+	for (; i < size; i++) {
+		char c = data[i];
+		if (c == needles[0] || c == needles[1] || c == needles[2] || c == needles[3])
+			return i;
+	}
+	return npos;
+}
+
+std::size_t find_first_of_sse2(const char *data, std::size_t size, const char *chars)
+{
+	char needles[max_chars];
+	load_needles(chars, needles);
+	return scan_sse2(data, size, needles);
+}
+
+std::size_t find_first_of_avx2(const char *data, std::size_t size, const char *chars)
+{
+	char needles[max_chars];
+	load_needles(chars, needles);
+	return scan_avx2(data, size, needles);
+}
+
+bool is_avx2_supported()
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+static std::size_t select_implementation(const char *data, std::size_t size, const char *chars)
+{
+#ifdef CHAR_SCANNER_X86
+	if (is_avx2_supported()) {
+		g_find_first_of = find_first_of_avx2;
+		g_implementation_name = "avx2";
+	} else {
+		g_find_first_of = find_first_of_sse2;
+		g_implementation_name = "sse2";
+	}
+#else
+	g_find_first_of = find_first_of_scalar;
+	g_implementation_name = "scalar";
+#endif
+	CORE_DEBUG("CharScanner: using the %s implementation", g_implementation_name);
+	return g_find_first_of(data, size, chars);
+}
+
+const char *implementation_name()
+{
+	// Make sure an implementation was selected
+	if (g_find_first_of == select_implementation)
+		find_first_of("", 0, " ");
+	return g_implementation_name;
+}
+
+}
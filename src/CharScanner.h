@@ -0,0 +1,39 @@
+//
+// Created by nathan on 4/7/23.
+//
+
+#ifndef CHARSCANNER_H
+#define CHARSCANNER_H
+
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(__i386__)
+# define CHAR_SCANNER_X86
+#endif
+
+// Vectorized search of the delimiters used by the protocol (CR, LF, space,
+//  ':', ';', ...). The fastest implementation supported by the CPU is picked
+//  on the first call: AVX2, SSE2 or a scalar fallback.
+namespace CharScanner
+{
+
+static const std::size_t	npos = static_cast<std::size_t>(-1);
+// Most characters that can be looked for at once
+static const std::size_t	max_chars = 4;
+
+/// Position of the first character of data found in chars (NUL terminated), or npos
+std::size_t	find_first_of(const char *data, std::size_t size, const char *chars);
+
+/// Implementations, exposed for the benchmarks
+std::size_t	find_first_of_scalar(const char *data, std::size_t size, const char *chars);
+#ifdef CHAR_SCANNER_X86
+std::size_t	find_first_of_sse2(const char *data, std::size_t size, const char *chars);
+std::size_t	find_first_of_avx2(const char *data, std::size_t size, const char *chars);
+bool		is_avx2_supported();
+#endif
+
+const char	*implementation_name();
+
+}
+
+#endif //CHARSCANNER_H
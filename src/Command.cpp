@@ -12,6 +12,28 @@ Command::Command(const std::string &command_str)
 	parse_message();
 }
 
+Command::Command(const CommandView& view)
+	:m_ill_formed(!view.is_valid()), m_index(0)
+{
+	m_tags.resize(view.tag_count());
+	for (std::size_t i = 0; i < view.tag_count(); i++) {
+		const CommandView::Tag& tag = view.tag(i);
+		m_tags[i].key.client_prefix = tag.client_prefix.str();
+		m_tags[i].key.vendor = tag.vendor.str();
+		m_tags[i].key.key_str = tag.key.str();
+		m_tags[i].value = tag.value.str();
+	}
+
+	m_source.source_name = view.source().name.str();
+	m_source.user = view.source().user.str();
+	m_source.host = view.source().host.str();
+	m_command = view.command().str();
+
+	m_parameters.reserve(view.parameter_count());
+	for (std::size_t i = 0; i < view.parameter_count(); i++)
+		m_parameters.push_back(view.parameter(i).str());
+}
+
 bool Command::is_valid()
 {
 	return !m_ill_formed;
@@ -8,6 +8,7 @@
 #include <string>
 #include <vector>
 #include "User.h"
+#include "CommandView.h"
 
 class Command
 {
@@ -33,6 +34,7 @@ public:
 	};
 
 	Command(const std::string& command_str);
+	explicit Command(const CommandView& view);
 
 	bool	is_valid();
 
@@ -0,0 +1,33 @@
+//
+// Created by nathan on 4/8/23.
+//
+
+#ifndef COMMANDHASH_H
+#define COMMANDHASH_H
+
+#include <cstddef>
+
+// Hash of the command names, shared by CommandTable.cpp and the generator of
+//  its slots in command_table/: the slot of a name only depends on its length
+//  and its first, second and last characters. Names are at least 2 characters.
+namespace CommandHash
+{
+
+/// Upper case for letters, other characters never match a command name anyway
+inline unsigned int	fold(char c)
+{
+	return static_cast<unsigned char>(c) & 0xDF;
+}
+
+inline std::size_t	hash(const char *name, std::size_t length, std::size_t second_char_multiplier,
+						std::size_t last_char_multiplier, std::size_t table_size)
+{
+	std::size_t h = length + fold(name[0])
+		+ fold(name[1]) * second_char_multiplier
+		+ fold(name[length - 1]) * last_char_multiplier;
+	return h % table_size;
+}
+
+}
+
+#endif //COMMANDHASH_H
@@ -0,0 +1,50 @@
+//
+// Created by nathan on 4/8/23.
+//
+
+// Commands known by the server, in CommandId order: define COMMAND_ENTRY(name)
+//  before including this file to expand each of them. A new command only
+//  needs its line here and its handler, the perfect hash of CommandTable.cpp
+//  is generated from this list at build time.
+
+// Registration
+COMMAND_ENTRY(CAP)
+COMMAND_ENTRY(NICK)
+COMMAND_ENTRY(PASS)
+COMMAND_ENTRY(USER)
+
+// Connection
+COMMAND_ENTRY(OPER)
+COMMAND_ENTRY(PING)
+COMMAND_ENTRY(PONG)
+COMMAND_ENTRY(QUIT)
+
+// Channels
+COMMAND_ENTRY(JOIN)
+COMMAND_ENTRY(PART)
+COMMAND_ENTRY(TOPIC)
+COMMAND_ENTRY(NAMES)
+COMMAND_ENTRY(LIST)
+COMMAND_ENTRY(KICK)
+COMMAND_ENTRY(MODE)
+COMMAND_ENTRY(PRIVMSG)
+COMMAND_ENTRY(NOTICE)
+COMMAND_ENTRY(INVITE)
+
+// Server
+COMMAND_ENTRY(ADMIN)
+COMMAND_ENTRY(MOTD)
+COMMAND_ENTRY(VERSION)
+COMMAND_ENTRY(TIME)
+COMMAND_ENTRY(INFO)
+COMMAND_ENTRY(LUSERS)
+COMMAND_ENTRY(STATS)
+COMMAND_ENTRY(KILL)
+
+// User queries
+COMMAND_ENTRY(WHO)
+COMMAND_ENTRY(WHOWAS)
+COMMAND_ENTRY(WHOIS)
+
+// Optional
+COMMAND_ENTRY(AWAY)
@@ -0,0 +1,51 @@
+//
+// Created by nathan on 4/8/23.
+//
+
+#include "CommandTable.h"
+#include "CommandHash.h"
+
+namespace CommandTable
+{
+
+// COMMAND_TABLE_SIZE, the multipliers and the slots, from CommandList.h
+#include "CommandTableSlots.h"
+
+// Indexed by CommandId
+static const char *names[COMMAND_COUNT] = {
+#define COMMAND_ENTRY(name) #name,
+#include "CommandList.h"
+#undef COMMAND_ENTRY
+};
+
+static std::size_t hash(const StringView& name)
+{
+	return CommandHash::hash(name.data(), name.size(), COMMAND_HASH_SECOND_CHAR, COMMAND_HASH_LAST_CHAR, COMMAND_TABLE_SIZE);
+}
+
+CommandId find(const StringView& name)
+{
+	if (name.size() < COMMAND_NAME_MIN_LENGTH || name.size() > COMMAND_NAME_MAX_LENGTH)
+		return COMMAND_UNKNOWN;
+
+	CommandId id = slots[hash(name)];
+	if (id == COMMAND_UNKNOWN)
+		return COMMAND_UNKNOWN;
+
+	// The slot only tells which command it could be
+	const char *candidate = names[id];
+	for (std::size_t i = 0; i < name.size(); i++) {
+		if (CommandHash::fold(name[i]) != static_cast<unsigned char>(candidate[i]))
+			return COMMAND_UNKNOWN;
+	}
+	return candidate[name.size()] == '\0' ? id : COMMAND_UNKNOWN;
+}
+
+const char *name(CommandId id)
+{
+	if (id >= COMMAND_COUNT)
+		return "";
+	return names[id];
+}
+
+}
@@ -0,0 +1,38 @@
+//
+// Created by nathan on 4/8/23.
+//
+
+#ifndef COMMANDTABLE_H
+#define COMMANDTABLE_H
+
+#include <cstddef>
+#include "StringView.h"
+
+/// Dense ids of the commands known by the server, used to index flat arrays
+enum CommandId
+{
+#define COMMAND_ENTRY(name) COMMAND_##name,
+#include "CommandList.h"
+#undef COMMAND_ENTRY
+
+	COMMAND_COUNT,
+	COMMAND_UNKNOWN = COMMAND_COUNT
+};
+
+// Resolves a command name to its id with a perfect hash: the slot of a name
+//  only depends on its length and its first, second and last characters, and
+//  no two commands share a slot. The multipliers and the slots are searched at
+//  build time by command_table_generator, which fails the build if the commands
+//  of CommandList.h can't be hashed without collisions.
+namespace CommandTable
+{
+
+/// Case insensitive, COMMAND_UNKNOWN if the name isn't a known command
+CommandId	find(const StringView& name);
+
+/// Upper case name of a command
+const char	*name(CommandId id);
+
+}
+
+#endif //COMMANDTABLE_H
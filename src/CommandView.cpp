@@ -0,0 +1,267 @@
+//
+// Created by nathan on 4/6/23.
+//
+
+#include <cctype>
+#include "CommandView.h"
+#include "CharScanner.h"
+#include "log.h"
+
+static const std::size_t npos = static_cast<std::size_t>(-1);
+
+static bool is_alpha(char c)		{ return std::isalpha(static_cast<unsigned char>(c)) != 0; }
+static bool is_digit(char c)		{ return std::isdigit(static_cast<unsigned char>(c)) != 0; }
+static bool is_key_char(char c)		{ return std::isalnum(static_cast<unsigned char>(c)) || c == '-'; }
+static bool is_vendor_char(char c)	{ return std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '.'; }
+
+CommandView::CommandView() :
+	m_index(0), m_is_valid(false), m_tag_count(0), m_parameter_count(0)
+{
+}
+
+CommandView::CommandView(const StringView& line) :
+	m_index(0), m_is_valid(false), m_tag_count(0), m_parameter_count(0)
+{
+	parse(line);
+}
+
+bool CommandView::parse(const StringView& line)
+{
+	m_line = line;
+	m_index = 0;
+	m_tag_count = 0;
+	m_source = Source();
+	m_command = StringView();
+	m_parameter_count = 0;
+
+	m_is_valid = parse_message();
+	return m_is_valid;
+}
+
+// Message
+bool CommandView::parse_message()
+{
+	if (characters_left() == 0)
+		return true;
+
+	if (consume_char('@')) {
+		if (!parse_tags()) {
+			CORE_WARN("Couldn't parse the tags after the @");
+			return false;
+		}
+		if (!consume_spaces()) {
+			CORE_WARN("Couldn't parse spaces after the tags");
+			return false;
+		}
+	}
+
+	if (consume_char(':')) {
+		if (!parse_source()) {
+			CORE_WARN("Couldn't parse source name after the :");
+			return false;
+		}
+		if (!consume_spaces()) {
+			CORE_WARN("Couldn't parse spaces after the source");
+			return false;
+		}
+	}
+
+	if (!parse_command()) {
+		CORE_WARN("Couldn't parse command string");
+		return false;
+	}
+
+	parse_parameters();
+
+	if (!consume_crlf()) {
+		CORE_WARN("Couldn't parse crlf");
+		return false;
+	}
+	return true;
+}
+
+bool CommandView::consume_spaces()
+{
+	if (!consume_char(' '))
+		return false;
+	while (consume_char(' '))
+		;
+	return true;
+}
+
+bool CommandView::consume_crlf()
+{
+	return consume_char('\r') || consume_char('\n');
+}
+
+// Tags
+bool CommandView::parse_tags()
+{
+	// At least one tag, and the list must end with a valid one
+	do {
+		if (!parse_tag())
+			return false;
+	} while (consume_char(';'));
+	return true;
+}
+
+bool CommandView::parse_tag()
+{
+	Tag tag;
+
+	std::size_t start = m_index;
+	if (consume_char('+'))
+		tag.client_prefix = view(start, m_index);
+
+	// Optional vendor, a host followed by a '/'
+	start = m_index;
+	while (characters_left() && is_vendor_char(current_char()))
+		m_index++;
+	if (m_index != start && consume_char('/'))
+		tag.vendor = view(start, m_index - 1);
+	else
+		m_index = start;
+
+	// The key itself can't be empty and must be followed by something
+	start = m_index;
+	while (characters_left() && is_key_char(current_char()))
+		m_index++;
+	if (m_index == start || characters_left() == 0)
+		return false;
+	tag.key = view(start, m_index);
+
+	if (consume_char('=')) {
+		std::size_t end_of_value = find_first_of("\r\n; ", m_index);
+		if (end_of_value != npos) {
+			tag.value = view(m_index, end_of_value);
+			m_index = end_of_value;
+		}
+	}
+
+	if (m_tag_count < COMMAND_MAX_TAGS)
+		m_tags[m_tag_count++] = tag;
+	return true;
+}
+
+// Source
+bool CommandView::parse_source()
+{
+	// A source must end with a space
+	std::size_t space_position = find_first_of(" ", m_index);
+	if (space_position == npos)
+		return false;
+
+	// The source name ends with either a '!', a '@' or a SPACE
+	std::size_t end_of_name = find_first_of("!@ ", m_index);
+	if (end_of_name == m_index)
+		return false;
+	m_source.name = view(m_index, end_of_name);
+	m_index = end_of_name;
+
+	if (consume_char('!')) {
+		std::size_t end_of_user = find_first_of("@ ", m_index);
+		m_source.user = view(m_index, end_of_user);
+		m_index = end_of_user;
+	}
+
+	if (consume_char('@')) {
+		m_source.host = view(m_index, space_position);
+		m_index = space_position;
+	}
+	return true;
+}
+
+// Command
+bool CommandView::parse_command()
+{
+	std::size_t start = m_index;
+	while (characters_left() && is_alpha(current_char()))
+		m_index++;
+
+	// If no letters were found, try parsing 3 digits
+	if (m_index == start && characters_left() >= 3
+		&& is_digit(m_line[m_index]) && is_digit(m_line[m_index + 1]) && is_digit(m_line[m_index + 2]))
+		m_index += 3;
+
+	m_command = view(start, m_index);
+	return !m_command.empty();
+}
+
+// Parameters
+void CommandView::parse_parameters()
+{
+	std::size_t old_index = m_index;
+	std::size_t index_before_space = m_index;
+
+	// First, parse the "middle" fields
+	while (consume_spaces()) {
+		// The last parameter takes the rest of the line
+		if (m_parameter_count == COMMAND_MAX_PARAMETERS - 1) {
+			consume_char(':');
+			parse_trailing();
+			return ;
+		}
+
+		if (!parse_middle())
+			break ;
+		index_before_space = m_index;
+	}
+
+	// Go back before the spaces consumed
+	m_index = index_before_space;
+
+	// Finally, parse the optional trailing field, which must start with a ':'
+	if (consume_spaces()) {
+		if (!consume_char(':')) {
+			m_index = old_index;
+			m_parameter_count = 0;
+			return ;
+		}
+		parse_trailing();
+	}
+}
+
+bool CommandView::parse_middle()
+{
+	// A middle can't start with a ':' but may contain some
+	if (!characters_left() || current_char() == ':')
+		return false;
+
+	std::size_t end_of_middle = find_first_of("\r\n ", m_index);
+	if (end_of_middle == npos || end_of_middle == m_index)
+		return false;
+
+	add_parameter(view(m_index, end_of_middle));
+	m_index = end_of_middle;
+	return true;
+}
+
+void CommandView::parse_trailing()
+{
+	std::size_t end_of_trailing = find_first_of("\r\n", m_index);
+	if (end_of_trailing == npos)
+		end_of_trailing = m_line.size();
+
+	add_parameter(view(m_index, end_of_trailing));
+	m_index = end_of_trailing;
+}
+
+// Helpers
+bool CommandView::consume_char(char c)
+{
+	if (!characters_left() || current_char() != c)
+		return false;
+	m_index++;
+	return true;
+}
+
+std::size_t CommandView::find_first_of(const char *chars, std::size_t start) const
+{
+	std::size_t position = CharScanner::find_first_of(m_line.data() + start, m_line.size() - start, chars);
+	return position == CharScanner::npos ? npos : start + position;
+}
+
+void CommandView::add_parameter(const StringView& parameter)
+{
+	m_parameters[m_parameter_count++] = parameter;
+}
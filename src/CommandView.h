@@ -0,0 +1,87 @@
+//
+// Created by nathan on 4/6/23.
+//
+
+#ifndef COMMANDVIEW_H
+#define COMMANDVIEW_H
+
+#include <cstddef>
+#include "StringView.h"
+
+// RFC 2812: at most 15 parameters, the last one taking the rest of the line
+#define COMMAND_MAX_PARAMETERS 15
+// Tags after this count are checked but not kept
+#define COMMAND_MAX_TAGS 32
+
+// Parses a message in place: every field is a view into the parsed line,
+//  so nothing is allocated. It accepts the same grammar as Command, which
+//  can be built from a CommandView when owned strings are needed.
+class CommandView
+{
+public:
+	struct Tag
+	{
+		StringView	client_prefix;
+		StringView	vendor;
+		StringView	key;
+		StringView	value;
+	};
+
+	struct Source
+	{
+		StringView	name;
+		StringView	user;
+		StringView	host;
+	};
+
+	CommandView();
+	explicit CommandView(const StringView& line);
+
+	bool	parse(const StringView& line);
+	bool	is_valid()	const { return m_is_valid; }
+
+	// Getters
+	const StringView&	line()							const { return m_line; }
+	std::size_t			tag_count()						const { return m_tag_count; }
+	const Tag&			tag(std::size_t i)				const { return m_tags[i]; }
+	const Source&		source()						const { return m_source; }
+	const StringView&	command()						const { return m_command; }
+	std::size_t			parameter_count()				const { return m_parameter_count; }
+	const StringView&	parameter(std::size_t i)		const { return m_parameters[i]; }
+
+private:
+	// Message
+	bool	parse_message();
+	bool	consume_spaces();
+	bool	consume_crlf();
+
+	// Fields
+	bool	parse_tags();
+	bool	parse_tag();
+	bool	parse_source();
+	bool	parse_command();
+	void	parse_parameters();
+	bool	parse_middle();
+	void	parse_trailing();
+
+	// Helpers
+	bool		consume_char(char c);
+	std::size_t	find_first_of(const char *chars, std::size_t start)	const;
+	std::size_t	characters_left()								const { return m_line.size() - m_index; }
+	char		current_char()									const { return m_line[m_index]; }
+	StringView	view(std::size_t start, std::size_t end)		const { return m_line.substr(start, end - start); }
+	void		add_parameter(const StringView& parameter);
+
+	StringView	m_line;
+	std::size_t	m_index;
+	bool		m_is_valid;
+
+	Tag			m_tags[COMMAND_MAX_TAGS];
+	std::size_t	m_tag_count;
+	Source		m_source;
+	StringView	m_command;
+	StringView	m_parameters[COMMAND_MAX_PARAMETERS];
+	std::size_t	m_parameter_count;
+};
+
+#endif //COMMANDVIEW_H
@@ -0,0 +1,62 @@
+//
+// Created by nathan on 4/3/23.
+//
+
+#include "ConnectionTable.h"
+#include "User.h"
+#include "log.h"
+
+const std::size_t ConnectionTable::npos = static_cast<std::size_t>(-1);
+
+void ConnectionTable::insert(User& user)
+{
+	std::size_t fd = static_cast<std::size_t>(user.fd());
+	if (fd >= m_positions.size())
+		m_positions.resize(fd + 1, npos);
+
+	if (m_positions[fd] != npos) {
+		CORE_WARN("Trying to insert a user on fd %d which is already used", user.fd());
+		return ;
+	}
+
+	m_positions[fd] = m_users.size();
+	m_users.push_back(&user);
+}
+
+bool ConnectionTable::remove(User& user)
+{
+	if (!contains(user))
+		return false;
+
+	std::size_t fd = static_cast<std::size_t>(user.fd());
+	std::size_t position = m_positions[fd];
+
+	// Move the last user into the freed position
+	User *last_user = m_users.back();
+	m_users[position] = last_user;
+	m_positions[static_cast<std::size_t>(last_user->fd())] = position;
+
+	m_users.pop_back();
+	m_positions[fd] = npos;
+	return true;
+}
+
+User* ConnectionTable::find(int fd) const
+{
+	std::size_t index = static_cast<std::size_t>(fd);
+	if (fd < 0 || index >= m_positions.size() || m_positions[index] == npos)
+		return NULL;
+	return m_users[m_positions[index]];
+}
+
+bool ConnectionTable::contains(const User& user) const
+{
+	return find(user.fd()) == &user;
+}
+
+ConnectionTable::iterator ConnectionTable::iterator_to(const User& user)
+{
+	if (!contains(user))
+		return m_users.end();
+	return m_users.begin() + static_cast<std::ptrdiff_t>(m_positions[static_cast<std::size_t>(user.fd())]);
+}
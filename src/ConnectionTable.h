@@ -0,0 +1,48 @@
+//
+// Created by nathan on 4/3/23.
+//
+
+#ifndef CONNECTIONTABLE_H
+#define CONNECTIONTABLE_H
+
+#include <vector>
+#include <cstddef>
+
+class User;
+
+// Dense list of the connected users, with the position of each user kept
+//  in an array indexed by its fd. Insertion and removal are O(1): a removed
+//  user is replaced by the last one of the list, so the order isn't kept.
+class ConnectionTable
+{
+public:
+	typedef std::vector<User*>			UserVector;
+	typedef UserVector::iterator		iterator;
+	typedef UserVector::const_iterator	const_iterator;
+
+	void	insert(User& user);
+	bool	remove(User& user);
+	User*	find(int fd) const;
+	bool	contains(const User& user) const;
+	/// Returns end() when the user isn't in the table
+	iterator	iterator_to(const User& user);
+
+	iterator		begin()							{ return m_users.begin(); }
+	iterator		end()							{ return m_users.end(); }
+	const_iterator	begin()					const	{ return m_users.begin(); }
+	const_iterator	end()					const	{ return m_users.end(); }
+	std::size_t		size()					const	{ return m_users.size(); }
+	bool			empty()					const	{ return m_users.empty(); }
+	User*			operator[](std::size_t i)	const	{ return m_users[i]; }
+
+	UserVector&			users()						{ return m_users; }
+	const UserVector&	users()				const	{ return m_users; }
+
+private:
+	static const std::size_t	npos;
+
+	UserVector					m_users;
+	std::vector<std::size_t>	m_positions;
+};
+
+#endif //CONNECTIONTABLE_H
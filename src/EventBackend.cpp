@@ -0,0 +1,250 @@
+//
+// Created by nathan on 4/2/23.
+//
+
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include "EventBackend.h"
+#include "log.h"
+
+#ifdef EVENT_BACKEND_EPOLL
+
+// ==============================================================================
+//	epoll backend: only the ready fds are reported back
+// ==============================================================================
+
+EventBackend::EventBackend()
+	: m_epoll_fd(-1)
+{
+}
+
+EventBackend::~EventBackend()
+{
+	shutdown();
+}
+
+bool EventBackend::initialize()
+{
+	m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (m_epoll_fd < 0) {
+		CORE_ERROR("epoll_create1: %s", strerror(errno));
+		return false;
+	}
+	m_native_events.resize(1024);
+	return true;
+}
+
+void EventBackend::shutdown()
+{
+	if (m_epoll_fd >= 0)
+		close(m_epoll_fd);
+	m_epoll_fd = -1;
+}
+
+uint32_t EventBackend::to_native_interest(int interest)
+{
+	uint32_t events = 0;
+	if (interest & EVENT_READ)
+		events |= EPOLLIN;
+	if (interest & EVENT_WRITE)
+		events |= EPOLLOUT;
+	return events;
+}
+
+bool EventBackend::add(int fd, int interest, void *data)
+{
+	epoll_event event = {};
+	event.events = to_native_interest(interest);
+	event.data.ptr = data;
+	if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+		CORE_ERROR("epoll_ctl(ADD): %s", strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+bool EventBackend::modify(int fd, int interest, void *data)
+{
+	epoll_event event = {};
+	event.events = to_native_interest(interest);
+	event.data.ptr = data;
+	if (epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, fd, &event) < 0) {
+		CORE_ERROR("epoll_ctl(MOD): %s", strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+bool EventBackend::remove(int fd)
+{
+	if (epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, NULL) < 0) {
+		CORE_ERROR("epoll_ctl(DEL): %s", strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+int EventBackend::wait(int timeout)
+{
+	m_ready_events.clear();
+
+	int ready_count = epoll_wait(m_epoll_fd, m_native_events.data(), static_cast<int>(m_native_events.size()), timeout);
+	if (ready_count < 0) {
+		if (errno != EINTR)
+			CORE_ERROR("epoll_wait: %s", strerror(errno));
+		return 0;
+	}
+
+	for (int i = 0; i < ready_count; i++) {
+		const epoll_event& native_event = m_native_events[static_cast<std::size_t>(i)];
+		Event event = {};
+		event.data = native_event.data.ptr;
+		// Errors and hang-ups are reported as readable so that the following read() fails
+		if (native_event.events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+			event.flags |= EVENT_READ;
+		if (native_event.events & EPOLLOUT)
+			event.flags |= EVENT_WRITE;
+		m_ready_events.push_back(event);
+	}
+
+	// The buffer was filled entirely, give it more room for the next call
+	if (static_cast<std::size_t>(ready_count) == m_native_events.size())
+		m_native_events.resize(m_native_events.size() * 2);
+
+	return ready_count;
+}
+
+const char *EventBackend::name()
+{
+	return "epoll";
+}
+
+#else
+
+// ==============================================================================
+//	poll() fallback backend
+// ==============================================================================
+
+EventBackend::EventBackend()
+{
+}
+
+EventBackend::~EventBackend()
+{
+	shutdown();
+}
+
+bool EventBackend::initialize()
+{
+	return true;
+}
+
+void EventBackend::shutdown()
+{
+	m_pollfds.clear();
+	m_datas.clear();
+	m_fd_positions.clear();
+}
+
+short EventBackend::to_native_interest(int interest)
+{
+	short events = 0;
+	if (interest & EVENT_READ)
+		events |= POLLIN;
+	if (interest & EVENT_WRITE)
+		events |= POLLOUT;
+	return events;
+}
+
+bool EventBackend::add(int fd, int interest, void *data)
+{
+	if (fd < 0)
+		return false;
+
+	std::size_t fd_index = static_cast<std::size_t>(fd);
+	if (fd_index >= m_fd_positions.size())
+		m_fd_positions.resize(fd_index + 1, static_cast<std::size_t>(-1));
+
+	pollfd new_pollfd = {};
+	new_pollfd.fd = fd;
+	new_pollfd.events = to_native_interest(interest);
+	new_pollfd.revents = 0;
+
+	m_fd_positions[fd_index] = m_pollfds.size();
+	m_pollfds.push_back(new_pollfd);
+	m_datas.push_back(data);
+	return true;
+}
+
+bool EventBackend::modify(int fd, int interest, void *data)
+{
+	std::size_t fd_index = static_cast<std::size_t>(fd);
+	if (fd < 0 || fd_index >= m_fd_positions.size() || m_fd_positions[fd_index] == static_cast<std::size_t>(-1)) {
+		CORE_ERROR("Trying to modify fd %d which isn't registered", fd);
+		return false;
+	}
+
+	std::size_t position = m_fd_positions[fd_index];
+	m_pollfds[position].events = to_native_interest(interest);
+	m_datas[position] = data;
+	return true;
+}
+
+bool EventBackend::remove(int fd)
+{
+	std::size_t fd_index = static_cast<std::size_t>(fd);
+	if (fd < 0 || fd_index >= m_fd_positions.size() || m_fd_positions[fd_index] == static_cast<std::size_t>(-1)) {
+		CORE_ERROR("Trying to remove fd %d which isn't registered", fd);
+		return false;
+	}
+
+	// Move the last entry into the freed position
+	std::size_t position = m_fd_positions[fd_index];
+	std::size_t last = m_pollfds.size() - 1;
+	if (position != last) {
+		m_pollfds[position] = m_pollfds[last];
+		m_datas[position] = m_datas[last];
+		m_fd_positions[static_cast<std::size_t>(m_pollfds[position].fd)] = position;
+	}
+	m_pollfds.pop_back();
+	m_datas.pop_back();
+	m_fd_positions[fd_index] = static_cast<std::size_t>(-1);
+	return true;
+}
+
+int EventBackend::wait(int timeout)
+{
+	m_ready_events.clear();
+
+	int ready_count = poll(m_pollfds.data(), static_cast<nfds_t>(m_pollfds.size()), timeout);
+	if (ready_count < 0) {
+		if (errno != EINTR)
+			CORE_ERROR("poll: %s", strerror(errno));
+		return 0;
+	}
+
+	for (std::size_t i = 0; i < m_pollfds.size() && m_ready_events.size() < static_cast<std::size_t>(ready_count); i++) {
+		short revents = m_pollfds[i].revents;
+		if (revents == 0)
+			continue;
+
+		Event event = {};
+		event.data = m_datas[i];
+		// Errors and hang-ups are reported as readable so that the following read() fails
+		if (revents & (POLLIN | POLLERR | POLLHUP | POLLNVAL))
+			event.flags |= EVENT_READ;
+		if (revents & POLLOUT)
+			event.flags |= EVENT_WRITE;
+		m_ready_events.push_back(event);
+	}
+
+	return ready_count;
+}
+
+const char *EventBackend::name()
+{
+	return "poll";
+}
+
+#endif
@@ -0,0 +1,81 @@
+//
+// Created by nathan on 4/2/23.
+//
+
+#ifndef EVENTBACKEND_H
+#define EVENTBACKEND_H
+
+#include <vector>
+#include <cstddef>
+
+// epoll is used on Linux unless the poll() fallback is explicitly requested
+//  (make EVENT_BACKEND=poll)
+#if defined(PLATFORM_LINUX) && !defined(EVENT_BACKEND_POLL)
+# define EVENT_BACKEND_EPOLL
+#endif
+
+#ifdef EVENT_BACKEND_EPOLL
+# include <sys/epoll.h>
+#else
+# include <sys/poll.h>
+#endif
+
+class EventBackend
+{
+public:
+	/// Interest / readiness flags
+	enum
+	{
+		EVENT_READ = 1,
+		EVENT_WRITE = 2
+	};
+
+	struct Event
+	{
+		void	*data;
+		int		flags;
+	};
+
+	typedef std::vector<Event>			EventVector;
+	typedef EventVector::const_iterator	ConstEventIterator;
+
+	EventBackend();
+	~EventBackend();
+
+	bool	initialize();
+	void	shutdown();
+
+	/// Registration, data is handed back untouched in the ready events
+	bool	add(int fd, int interest, void *data);
+	bool	modify(int fd, int interest, void *data);
+	bool	remove(int fd);
+
+	/// Waits for at most timeout ms and returns the number of ready fds
+	int		wait(int timeout);
+
+	const EventVector&	ready_events()	const { return m_ready_events; }
+	static const char*	name();
+
+private:
+	EventBackend(const EventBackend& other);
+	EventBackend& operator=(const EventBackend& other);
+
+	EventVector	m_ready_events;
+
+#ifdef EVENT_BACKEND_EPOLL
+	static uint32_t	to_native_interest(int interest);
+
+	int							m_epoll_fd;
+	std::vector<epoll_event>	m_native_events;
+#else
+	static short	to_native_interest(int interest);
+
+	// Dense pollfd array, with the position of each fd kept in m_fd_positions
+	//  so that fds can be swap-removed in O(1)
+	std::vector<pollfd>			m_pollfds;
+	std::vector<void*>			m_datas;
+	std::vector<std::size_t>	m_fd_positions;
+#endif
+};
+
+#endif //EVENTBACKEND_H
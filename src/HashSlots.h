@@ -0,0 +1,106 @@
+//
+// Created by nathan on 4/9/23.
+//
+
+#ifndef HASHSLOTS_H
+#define HASHSLOTS_H
+
+#include <vector>
+#include <cstddef>
+
+// Open addressing table with linear probing, shared by the hash indexes of the
+//  server. The slots are described by Traits:
+//   typedef ... Slot;
+//   static Slot			empty_slot();
+//   static bool			is_empty(const Slot& slot);
+//   static std::size_t	hash(const Slot& slot);
+//  The number of slots is a power of 2, doubled to keep the load factor under
+//  1/2, and removals use backward shift deletion so no tombstone is left.
+template<typename Traits>
+class HashSlots
+{
+public:
+	typedef typename Traits::Slot	Slot;
+
+	static const std::size_t	npos = static_cast<std::size_t>(-1);
+
+	explicit HashSlots(std::size_t min_slots) : m_slots(min_slots, Traits::empty_slot()), m_size(0), m_min_slots(min_slots) {}
+
+	/// Position of the first slot of the hash's probe sequence accepted by
+	///  matches(slot), npos if an empty slot is reached first
+	template<typename Matcher>
+	std::size_t	find(std::size_t hash, const Matcher& matches) const
+	{
+		for (std::size_t position = hash & mask(); !Traits::is_empty(m_slots[position]); position = (position + 1) & mask()) {
+			if (matches(m_slots[position]))
+				return position;
+		}
+		return npos;
+	}
+
+	/// The slot must not be in the table already
+	void	insert(const Slot& slot)
+	{
+		if ((m_size + 1) * 2 > m_slots.size())
+			grow();
+		insert_slot(slot);
+		m_size++;
+	}
+
+	/// Invalidates the positions of the other slots
+	void	remove(std::size_t position)
+	{
+		// Move back the following slots that would otherwise become unreachable
+		std::size_t hole = position;
+		for (std::size_t next = (hole + 1) & mask(); !Traits::is_empty(m_slots[next]); next = (next + 1) & mask()) {
+			std::size_t ideal = Traits::hash(m_slots[next]) & mask();
+			if (((hole - ideal) & mask()) < ((next - ideal) & mask())) {
+				m_slots[hole] = m_slots[next];
+				hole = next;
+			}
+		}
+		m_slots[hole] = Traits::empty_slot();
+		m_size--;
+	}
+
+	void	clear()
+	{
+		m_slots.assign(m_min_slots, Traits::empty_slot());
+		m_size = 0;
+	}
+
+	Slot&		operator[](std::size_t position)		{ return m_slots[position]; }
+	const Slot&	operator[](std::size_t position)	const	{ return m_slots[position]; }
+	std::size_t	size()								const	{ return m_size; }
+	bool		empty()								const	{ return m_size == 0; }
+
+private:
+	std::size_t	mask()	const { return m_slots.size() - 1; }
+
+	void	insert_slot(const Slot& slot)
+	{
+		std::size_t position = Traits::hash(slot) & mask();
+		while (!Traits::is_empty(m_slots[position]))
+			position = (position + 1) & mask();
+		m_slots[position] = slot;
+	}
+
+	void	grow()
+	{
+		std::vector<Slot> old_slots(m_slots.size() * 2, Traits::empty_slot());
+		old_slots.swap(m_slots);
+		for (std::size_t i = 0; i < old_slots.size(); i++) {
+			if (!Traits::is_empty(old_slots[i]))
+				insert_slot(old_slots[i]);
+		}
+	}
+
+	std::vector<Slot>	m_slots;
+	std::size_t			m_size;
+	std::size_t			m_min_slots;
+};
+
+template<typename Traits>
+const std::size_t HashSlots<Traits>::npos;
+
+#endif //HASHSLOTS_H
@@ -0,0 +1,140 @@
+//
+// Created by nathan on 4/10/23.
+//
+
+#include "Hostmask.h"
+#include "Casemapping.h"
+
+Hostmask::Hostmask() : m_min_length(0)
+{
+	compile(StringView());
+}
+
+Hostmask::Hostmask(const StringView& pattern) : m_min_length(0)
+{
+	compile(pattern);
+}
+
+void Hostmask::compile(const StringView& pattern)
+{
+	m_pattern = pattern.str();
+	m_segments.clear();
+	m_program.clear();
+	m_min_length = 0;
+
+	bool has_star_before = false;
+	std::size_t index = 0;
+	while (true) {
+		std::size_t start = index;
+		while (index < pattern.size() && pattern[index] != '*')
+			m_segments += Casemapping::fold(pattern[index++]);
+
+		Instruction instruction;
+		instruction.offset = static_cast<unsigned short>(m_segments.size() - (index - start));
+		instruction.length = static_cast<unsigned short>(index - start);
+		m_min_length += instruction.length;
+
+		bool has_star_after = index < pattern.size();
+		if (!has_star_after) {
+			// The last segment
+			instruction.opcode = has_star_before ? MATCH_END : MATCH_START;
+			if (instruction.length != 0)
+				m_program.push_back(instruction);
+			if (!has_star_before)
+				add_instruction(END);
+			return ;
+		}
+
+		instruction.opcode = has_star_before ? FIND : MATCH_START;
+		if (instruction.length != 0)
+			m_program.push_back(instruction);
+		has_star_before = true;
+
+		while (index < pattern.size() && pattern[index] == '*')
+			index++;
+		if (index == pattern.size()) {
+			add_instruction(ACCEPT);
+			return ;
+		}
+	}
+}
+
+bool Hostmask::matches(const StringView& subject) const
+{
+	if (subject.size() < m_min_length)
+		return false;
+
+	std::size_t cursor = 0;
+	for (std::vector<Instruction>::const_iterator it = m_program.begin(); it != m_program.end(); ++it) {
+		switch (it->opcode) {
+			case MATCH_START:
+				if (!segment_matches(*it, subject.data() + cursor))
+					return false;
+				cursor += it->length;
+				break ;
+			case FIND: {
+				// The segments left need at least their own length
+				std::size_t last = subject.size() - it->length;
+				while (cursor <= last && !segment_matches(*it, subject.data() + cursor))
+					cursor++;
+				if (cursor > last)
+					return false;
+				cursor += it->length;
+				break ;
+			}
+			case MATCH_END:
+				if (subject.size() - cursor < it->length)
+					return false;
+				return segment_matches(*it, subject.data() + subject.size() - it->length);
+			case END:
+				return cursor == subject.size();
+			case ACCEPT:
+				return true;
+			default:
+				break ;
+		}
+	}
+	return true;
+}
+
+void Hostmask::add_instruction(Opcode opcode)
+{
+	Instruction instruction;
+	instruction.opcode = opcode;
+	instruction.offset = 0;
+	instruction.length = 0;
+	m_program.push_back(instruction);
+}
+
+bool Hostmask::segment_matches(const Instruction& instruction, const char *subject) const
+{
+	const char *segment = m_segments.data() + instruction.offset;
+	for (std::size_t i = 0; i < instruction.length; i++) {
+		if (segment[i] != '?' && segment[i] != Casemapping::fold(subject[i]))
+			return false;
+	}
+	return true;
+}
+
+std::string Hostmask::normalize(const std::string& mask)
+{
+	std::string::size_type exclamation_mark = mask.find('!');
+	std::string::size_type at_sign = mask.find('@', exclamation_mark == std::string::npos ? 0 : exclamation_mark);
+
+	if (exclamation_mark == std::string::npos && at_sign == std::string::npos)
+		return mask + "!*@*";
+	if (exclamation_mark == std::string::npos)
+		return "*!" + mask;
+	if (at_sign == std::string::npos)
+		return mask + "@*";
+	return mask;
+}
+
+bool Hostmask::has_wildcards(const StringView& pattern)
+{
+	for (std::size_t i = 0; i < pattern.size(); i++) {
+		if (pattern[i] == '*' || pattern[i] == '?')
+			return true;
+	}
+	return false;
+}
@@ -0,0 +1,64 @@
+//
+// Created by nathan on 4/10/23.
+//
+
+#ifndef HOSTMASK_H
+#define HOSTMASK_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include "StringView.h"
+
+// Glob pattern compiled once into a small matcher program, for the channel
+//  masks and WHO. '*' matches any sequence and '?' any character, the
+//  compares go through the server's Casemapping.
+//  The pattern is split on its stars into segments, each one becomes an
+//  instruction: the segment before the first star must match at the start,
+//  the one after the last star at the end, and the ones in between are
+//  searched for left to right. Taking the leftmost occurrence is always
+//  right for '*' globs, so a match never backtracks.
+class Hostmask
+{
+public:
+	Hostmask();
+	explicit Hostmask(const StringView& pattern);
+
+	void	compile(const StringView& pattern);
+	bool	matches(const StringView& subject)	const;
+
+	const std::string&	pattern()	const { return m_pattern; }
+
+	/// Completes a mask to the nick!user@host form: "nick" becomes
+	///  "nick!*@*", "user@host" becomes "*!user@host" and "nick!user" "nick!user@*"
+	static std::string	normalize(const std::string& mask);
+	static bool			has_wildcards(const StringView& pattern);
+
+private:
+	enum Opcode
+	{
+		MATCH_START,	// The segment is at the cursor
+		FIND,			// The segment is somewhere after the cursor
+		MATCH_END,		// The segment ends the subject
+		END,			// Nothing is left after the cursor
+		ACCEPT			// Anything is left after the cursor
+	};
+
+	struct Instruction
+	{
+		Opcode			opcode;
+		unsigned short	offset;
+		unsigned short	length;
+	};
+
+	void	add_instruction(Opcode opcode);
+	bool	segment_matches(const Instruction& instruction, const char *subject)	const;
+
+	std::string					m_pattern;
+	// The segments of the pattern, folded, that the instructions point into
+	std::string					m_segments;
+	std::vector<Instruction>	m_program;
+	std::size_t					m_min_length;
+};
+
+#endif //HOSTMASK_H
@@ -0,0 +1,155 @@
+//
+// Created by nathan on 4/4/23.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <sys/uio.h>
+#include "InputBuffer.h"
+#include "CharScanner.h"
+#include "log.h"
+
+const std::size_t InputBuffer::npos = static_cast<std::size_t>(-1);
+
+InputBuffer::InputBuffer(std::size_t initial_capacity, std::size_t max_capacity) :
+	m_initial_capacity(std::min(initial_capacity, max_capacity)), m_max_capacity(max_capacity), m_head(0), m_size(0), m_scanned(0), m_is_dropping_line(false)
+{
+}
+
+ssize_t InputBuffer::read_from(int fd)
+{
+	if (free_space() == 0)
+		grow();
+
+	// The free space is at most two chunks: after the data, and before m_head when it wrapped
+	std::size_t tail = (m_head + m_size) % capacity();
+	std::size_t free_bytes = free_space();
+
+	iovec chunks[2];
+	int chunk_count = 1;
+	chunks[0].iov_base = &m_data[tail];
+	chunks[0].iov_len = std::min(free_bytes, capacity() - tail);
+	if (chunks[0].iov_len < free_bytes) {
+		chunks[1].iov_base = &m_data[0];
+		chunks[1].iov_len = free_bytes - chunks[0].iov_len;
+		chunk_count = 2;
+	}
+
+	ssize_t bytes_read = readv(fd, chunks, chunk_count);
+	if (bytes_read <= 0)
+		return bytes_read;
+
+	m_size += static_cast<std::size_t>(bytes_read);
+	drop_overflowing_line();
+	return bytes_read;
+}
+
+bool InputBuffer::has_line()
+{
+	return find_line_end() != npos;
+}
+
+bool InputBuffer::peek_line(StringView& line)
+{
+	std::size_t line_end = find_line_end();
+	if (line_end == npos)
+		return false;
+
+	std::size_t length = line_length(line_end);
+	if (m_head + length > capacity())
+		compact();
+
+	line = StringView(&m_data[m_head], length);
+	return true;
+}
+
+void InputBuffer::skip_line()
+{
+	std::size_t line_end = find_line_end();
+	if (line_end != npos)
+		consume(line_length(line_end));
+}
+
+std::string InputBuffer::to_string() const
+{
+	std::string str;
+	str.reserve(m_size);
+	for (std::size_t i = 0; i < m_size; i++)
+		str += at(i);
+	return str;
+}
+
+std::size_t InputBuffer::find_line_end()
+{
+	// The data left to scan is at most two chunks, before and after the end of the ring
+	while (m_scanned < m_size) {
+		std::size_t position = (m_head + m_scanned) % capacity();
+		std::size_t length = std::min(m_size - m_scanned, capacity() - position);
+
+		std::size_t line_end = CharScanner::find_first_of(&m_data[position], length, "\r\n");
+		if (line_end != CharScanner::npos) {
+			m_scanned += line_end;
+			return m_scanned;
+		}
+		m_scanned += length;
+	}
+	return npos;
+}
+
+std::size_t InputBuffer::line_length(std::size_t line_end) const
+{
+	// A line ends with one or two of '\r' and '\n'
+	std::size_t length = line_end + 1;
+	if (length < m_size && is_line_end(at(length)))
+		length++;
+	return length;
+}
+
+void InputBuffer::consume(std::size_t length)
+{
+	m_size -= length;
+	m_head = m_size == 0 ? 0 : (m_head + length) % capacity();
+	m_scanned = 0;
+}
+
+void InputBuffer::grow()
+{
+	std::size_t new_capacity = m_data.empty() ? m_initial_capacity : std::min(capacity() * 2, m_max_capacity);
+
+	// The data is unwrapped to the start of the new ring, m_scanned stays relative to m_head
+	std::vector<char> data(new_capacity);
+	if (m_size > 0) {
+		std::size_t first_chunk = std::min(m_size, capacity() - m_head);
+		std::memcpy(&data[0], &m_data[m_head], first_chunk);
+		if (first_chunk < m_size)
+			std::memcpy(&data[first_chunk], &m_data[0], m_size - first_chunk);
+	}
+	m_data.swap(data);
+	m_head = 0;
+}
+
+void InputBuffer::compact()
+{
+	std::rotate(m_data.begin(), m_data.begin() + static_cast<std::ptrdiff_t>(m_head), m_data.end());
+	m_head = 0;
+}
+
+void InputBuffer::drop_overflowing_line()
+{
+	// Finish dropping a line that was too long, up to its end
+	if (m_is_dropping_line) {
+		std::size_t line_end = find_line_end();
+		if (line_end == npos) {
+			consume(m_size);
+			return ;
+		}
+		consume(line_length(line_end));
+		m_is_dropping_line = false;
+	}
+
+	if (full() && !has_line()) {
+		CORE_WARN("Dropping a line longer than the %llu bytes of the input buffer", static_cast<unsigned long long>(capacity()));
+		consume(m_size);
+		m_is_dropping_line = true;
+	}
+}
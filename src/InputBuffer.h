@@ -0,0 +1,70 @@
+//
+// Created by nathan on 4/4/23.
+//
+
+#ifndef INPUTBUFFER_H
+#define INPUTBUFFER_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <sys/types.h>
+#include "StringView.h"
+
+// Ring buffer holding the bytes received from a connection.
+//  Data is read straight into the free space with readv() and lines are
+//  scanned in place, so consuming a line never moves the rest of the buffer.
+//  The data is only compacted when a line wraps around the end of the buffer,
+//  so that lines can always be handed out as contiguous views.
+//  Nothing is allocated until the first read, a connection that never sends
+//  anything doesn't hold any memory. The ring then starts at initial_capacity
+//  and doubles whenever it fills up, up to max_capacity, and is kept
+//  until the connection closes.
+//  A line that doesn't fit in max_capacity is dropped.
+class InputBuffer
+{
+public:
+	InputBuffer(std::size_t initial_capacity, std::size_t max_capacity);
+
+	/// Reads as much as the free space allows, same return value as read()
+	ssize_t		read_from(int fd);
+
+	bool		has_line();
+	/// The view stays valid until the buffer is modified
+	bool		peek_line(StringView& line);
+	void		skip_line();
+
+	std::size_t	size()			const	{ return m_size; }
+	/// Of the ring currently allocated
+	std::size_t	capacity()		const	{ return m_data.size(); }
+	std::size_t	free_space()	const	{ return m_data.size() - m_size; }
+	bool		empty()			const	{ return m_size == 0; }
+	/// No more data can be read, the ring can't grow anymore
+	bool		full()			const	{ return m_size == m_max_capacity; }
+
+	std::string	to_string()		const;
+
+private:
+	static bool	is_line_end(char c) { return c == '\r' || c == '\n'; }
+
+	char		at(std::size_t offset)	const	{ return m_data[(m_head + offset) % m_data.size()]; }
+	std::size_t	find_line_end();
+	std::size_t	line_length(std::size_t line_end)	const;
+	void		consume(std::size_t length);
+	void		grow();
+	void		compact();
+	void		drop_overflowing_line();
+
+	static const std::size_t	npos;
+
+	std::vector<char>	m_data;
+	std::size_t			m_initial_capacity;
+	std::size_t			m_max_capacity;
+	std::size_t			m_head;
+	std::size_t			m_size;
+	// Number of bytes after m_head already known not to contain a line end
+	std::size_t			m_scanned;
+	bool				m_is_dropping_line;
+};
+
+#endif //INPUTBUFFER_H
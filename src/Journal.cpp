@@ -0,0 +1,180 @@
+//
+// Created by nathan on 4/10/23.
+//
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include "Journal.h"
+#include "Utils.h"
+#include "log.h"
+
+// Small enough files would rotate on every record
+#define JOURNAL_MIN_FILE_SIZE (64 * 1024)
+
+namespace Journal
+{
+
+bool					g_is_started = false;
+
+static std::string		g_path;
+static std::size_t		g_file_size = 0;
+static std::size_t		g_file_count = 0;
+static int				g_fd = -1;
+static char				*g_data = NULL;
+static FileHeader		*g_header = NULL;
+static std::size_t		g_end = 0;
+
+static bool			open_file();
+static void			close_file();
+static void			shift_files();
+static std::string	rotated_path(std::size_t index);
+static uint64_t		now();
+
+bool start(const std::string& path, std::size_t file_size, std::size_t file_count)
+{
+	if (g_is_started)
+		return true;
+
+	g_path = path;
+	g_file_size = file_size < JOURNAL_MIN_FILE_SIZE ? JOURNAL_MIN_FILE_SIZE : file_size;
+	g_file_count = file_count == 0 ? 1 : file_count;
+	if (!open_file())
+		return false;
+
+	g_is_started = true;
+	CORE_INFO("Journaling the traffic to %s, %llu files of %llu bytes", g_path.c_str(), static_cast<unsigned long long>(g_file_count), static_cast<unsigned long long>(g_file_size));
+	return true;
+}
+
+void stop()
+{
+	if (!g_is_started)
+		return ;
+	close_file();
+	g_is_started = false;
+}
+
+void write(uint32_t connection, Direction direction, CommandId command, const char *line, std::size_t length)
+{
+	if (length > 0 && line[length - 1] == '\n')
+		length--;
+	if (length > 0 && line[length - 1] == '\r')
+		length--;
+
+	// A line that wouldn't fit even in an empty file is cut
+	std::size_t max_length = g_file_size - sizeof(FileHeader) - sizeof(RecordHeader);
+	if (length > max_length)
+		length = max_length;
+
+	if (g_end + sizeof(RecordHeader) + length > g_file_size) {
+		close_file();
+		if (!open_file()) {
+			g_is_started = false;
+			CORE_ERROR("Couldn't rotate the journal, the traffic isn't journaled anymore");
+			return ;
+		}
+	}
+
+	RecordHeader header;
+	std::memset(&header, 0, sizeof(header));
+	header.timestamp = now();
+	header.connection = connection;
+	header.length = static_cast<uint32_t>(length);
+	header.command = static_cast<uint16_t>(command);
+	header.direction = static_cast<uint8_t>(direction);
+
+	std::memcpy(g_data + g_end, &header, sizeof(header));
+	std::memcpy(g_data + g_end + sizeof(header), line, length);
+	g_end += sizeof(header) + length;
+	g_header->end = g_end;
+}
+
+static bool open_file()
+{
+	shift_files();
+
+	g_fd = open(g_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (g_fd < 0) {
+		CORE_ERROR("Couldn't open the journal [%s]: %s", g_path.c_str(), strerror(errno));
+		return false;
+	}
+
+	// The blocks are reserved up front, a full disk would otherwise be a SIGBUS when writing to the mapping
+#ifdef PLATFORM_LINUX
+	int error = posix_fallocate(g_fd, 0, static_cast<off_t>(g_file_size));
+#else
+	int error = ftruncate(g_fd, static_cast<off_t>(g_file_size)) < 0 ? errno : 0;
+#endif
+	if (error != 0) {
+		CORE_ERROR("Couldn't allocate the journal [%s]: %s", g_path.c_str(), strerror(error));
+		close(g_fd);
+		g_fd = -1;
+		return false;
+	}
+
+	void *data = mmap(NULL, g_file_size, PROT_READ | PROT_WRITE, MAP_SHARED, g_fd, 0);
+	if (data == MAP_FAILED) {
+		CORE_ERROR("Couldn't map the journal [%s]: %s", g_path.c_str(), strerror(errno));
+		close(g_fd);
+		g_fd = -1;
+		return false;
+	}
+	// The records have any length, so only the file header is aligned
+	g_data = static_cast<char *>(data);
+	g_header = static_cast<FileHeader *>(data);
+
+	std::memset(g_header, 0, sizeof(FileHeader));
+	std::memcpy(g_header->magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+	g_header->version = JOURNAL_VERSION;
+	g_header->header_size = sizeof(RecordHeader);
+	g_header->created = now();
+	g_end = sizeof(FileHeader);
+	g_header->end = g_end;
+	return true;
+}
+
+static void close_file()
+{
+	if (g_fd < 0)
+		return ;
+
+	munmap(g_data, g_file_size);
+	g_data = NULL;
+	g_header = NULL;
+	// Only the records are kept, the rest of the preallocated space is given back
+	if (ftruncate(g_fd, static_cast<off_t>(g_end)) < 0)
+		CORE_WARN("Couldn't truncate the journal [%s]: %s", g_path.c_str(), strerror(errno));
+	close(g_fd);
+	g_fd = -1;
+}
+
+static void shift_files()
+{
+	// The oldest file is overwritten by the rename
+	for (std::size_t i = g_file_count - 1; i > 0; i--) {
+		std::string from = rotated_path(i - 1);
+		if (std::rename(from.c_str(), rotated_path(i).c_str()) < 0 && errno != ENOENT)
+			CORE_WARN("Couldn't rotate the journal [%s]: %s", from.c_str(), strerror(errno));
+	}
+}
+
+static std::string rotated_path(std::size_t index)
+{
+	if (index == 0)
+		return g_path;
+	return g_path + "." + to_string(index);
+}
+
+static uint64_t now()
+{
+	timeval time;
+	gettimeofday(&time, NULL);
+	return static_cast<uint64_t>(time.tv_sec) * 1000000 + static_cast<uint64_t>(time.tv_usec);
+}
+
+}
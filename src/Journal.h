@@ -0,0 +1,79 @@
+//
+// Created by nathan on 4/10/23.
+//
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <string>
+#include <cstddef>
+#include <stdint.h>
+#include "CommandTable.h"
+
+#define JOURNAL_MAGIC "IRCJRNL"
+#define JOURNAL_VERSION 1
+
+// Binary journal of the IRC traffic: every line received from or sent to a
+//  connection is appended as a fixed header followed by the line, without its
+//  "\r\n". The file is memory mapped, so a record is a couple of memcpy, and
+//  once full it is rotated: path becomes path.1, path.1 becomes path.2... up to
+//  the number of files kept. The records are read back by the irc_journal tool.
+namespace Journal
+{
+
+enum Direction
+{
+	DIRECTION_IN,
+	DIRECTION_OUT
+};
+
+/// At the start of every file, end is updated after each record so that a
+///  reader never goes past the last complete one
+struct FileHeader
+{
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	header_size;
+	uint64_t	created;		// Microseconds since the epoch
+	uint64_t	end;			// Offset of the end of the last record
+};
+
+struct RecordHeader
+{
+	uint64_t	timestamp;		// Microseconds since the epoch
+	uint32_t	connection;		// User::connection_id()
+	uint32_t	length;			// Of the line following the header
+	uint16_t	command;		// CommandId of the line, or of the command that sent it for outgoing lines
+	uint8_t		direction;		// Direction
+	uint8_t		reserved[5];
+};
+
+/// Only read through is_started()
+extern bool	g_is_started;
+
+/// Creates the file at path, of file_size bytes, keeping file_count files when rotating
+bool		start(const std::string& path, std::size_t file_size, std::size_t file_count);
+/// Truncates the current file to its records and unmaps it
+void		stop();
+inline bool	is_started()		{ return g_is_started; }
+
+/// The line may end with its "\r\n", it isn't recorded
+void		write(uint32_t connection, Direction direction, CommandId command, const char *line, std::size_t length);
+
+/// Cheap when the journal is off, the calls don't leave the caller
+inline void	record_received(uint32_t connection, CommandId command, const char *line, std::size_t length)
+{
+	if (is_started())
+		write(connection, DIRECTION_IN, command, line, length);
+}
+
+/// Outgoing lines are recorded with the command being executed, COMMAND_UNKNOWN outside of one
+inline void	record_sent(uint32_t connection, CommandId command, const char *line, std::size_t length)
+{
+	if (is_started())
+		write(connection, DIRECTION_OUT, command, line, length);
+}
+
+}
+
+#endif //JOURNAL_H
@@ -0,0 +1,80 @@
+//
+// Created by nathan on 4/10/23.
+//
+
+#include <algorithm>
+#include <cstring>
+#include "LatencyHistogram.h"
+
+#define LATENCY_SUB_BUCKETS (1u << LATENCY_SUB_BUCKET_BITS)
+
+LatencyHistogram::LatencyHistogram()
+{
+	clear();
+}
+
+void LatencyHistogram::record(uint64_t value)
+{
+	m_buckets[bucket_index(value)]++;
+	m_count++;
+	m_max = std::max(m_max, value);
+	m_total += value;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other)
+{
+	for (std::size_t i = 0; i < LATENCY_BUCKET_COUNT; i++)
+		m_buckets[i] += other.m_buckets[i];
+	m_count += other.m_count;
+	m_max = std::max(m_max, other.m_max);
+	m_total += other.m_total;
+}
+
+void LatencyHistogram::clear()
+{
+	std::memset(m_buckets, 0, sizeof(m_buckets));
+	m_count = 0;
+	m_max = 0;
+	m_total = 0;
+}
+
+uint64_t LatencyHistogram::percentile(double fraction) const
+{
+	if (m_count == 0)
+		return 0;
+
+	// Rank of the value, from 1 to m_count
+	std::size_t rank = static_cast<std::size_t>(fraction * static_cast<double>(m_count) + 0.5);
+	rank = std::min(std::max<std::size_t>(rank, 1), m_count);
+
+	std::size_t seen = 0;
+	for (std::size_t i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+		seen += m_buckets[i];
+		if (seen >= rank)
+			return std::min(bucket_upper_bound(i), m_max);
+	}
+	return m_max;
+}
+
+std::size_t LatencyHistogram::bucket_index(uint64_t value)
+{
+	if (value < LATENCY_SUB_BUCKETS)
+		return static_cast<std::size_t>(value);
+	if (value >> LATENCY_MAX_VALUE_BITS)
+		return LATENCY_BUCKET_COUNT - 1;
+
+	// The highest bit picks the power of 2, the next ones the sub-bucket
+	unsigned int shift = static_cast<unsigned int>(63 - __builtin_clzll(value)) - LATENCY_SUB_BUCKET_BITS;
+	std::size_t sub_bucket = static_cast<std::size_t>(value >> shift) & (LATENCY_SUB_BUCKETS - 1);
+	return ((shift + 1) << LATENCY_SUB_BUCKET_BITS) + sub_bucket;
+}
+
+uint64_t LatencyHistogram::bucket_upper_bound(std::size_t index)
+{
+	if (index < LATENCY_SUB_BUCKETS)
+		return index;
+
+	unsigned int shift = static_cast<unsigned int>(index >> LATENCY_SUB_BUCKET_BITS) - 1;
+	uint64_t lower_bound = static_cast<uint64_t>(LATENCY_SUB_BUCKETS + (index & (LATENCY_SUB_BUCKETS - 1))) << shift;
+	return lower_bound + (static_cast<uint64_t>(1) << shift) - 1;
+}
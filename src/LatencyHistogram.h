@@ -0,0 +1,49 @@
+//
+// Created by nathan on 4/10/23.
+//
+
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <cstddef>
+#include <stdint.h>
+
+// Sub-buckets of each power of 2, a recorded value is known within 1/8th
+#define LATENCY_SUB_BUCKET_BITS 3
+// Larger values (about 68 seconds in nanoseconds) are counted as this one
+#define LATENCY_MAX_VALUE_BITS 36
+#define LATENCY_BUCKET_COUNT ((LATENCY_MAX_VALUE_BITS - LATENCY_SUB_BUCKET_BITS + 1) << LATENCY_SUB_BUCKET_BITS)
+
+// Log-linear histogram of durations in nanoseconds: values under 8 each have
+//  their bucket, then every power of 2 is split in 8 equal buckets. Recording
+//  is a couple of shifts and an increment, and the size stays fixed however
+//  many values are recorded.
+class LatencyHistogram
+{
+public:
+	LatencyHistogram();
+
+	void		record(uint64_t value);
+	/// Adds the values recorded by the other histogram
+	void		merge(const LatencyHistogram& other);
+	void		clear();
+
+	/// Upper bound of the bucket holding the value under which the given
+	///  fraction of the values are, 0 when nothing was recorded
+	uint64_t	percentile(double fraction)	const;
+
+	std::size_t	count()		const	{ return m_count; }
+	uint64_t	max()		const	{ return m_max; }
+	uint64_t	total()		const	{ return m_total; }
+
+private:
+	static std::size_t	bucket_index(uint64_t value);
+	static uint64_t		bucket_upper_bound(std::size_t index);
+
+	std::size_t	m_buckets[LATENCY_BUCKET_COUNT];
+	std::size_t	m_count;
+	uint64_t	m_max;
+	uint64_t	m_total;
+};
+
+#endif //LATENCYHISTOGRAM_H
@@ -0,0 +1,217 @@
+//
+// Created by nathan on 4/10/23.
+//
+
+#include <algorithm>
+#include "MaskIndex.h"
+#include "Casemapping.h"
+
+#define MASK_INDEX_MIN_BUCKETS 8
+
+const std::size_t MaskIndex::npos = static_cast<std::size_t>(-1);
+
+MaskIndex::MaskIndex() : m_buckets(MASK_INDEX_MIN_BUCKETS), m_used_buckets(0)
+{
+}
+
+void MaskIndex::add(const std::string& pattern)
+{
+	Entry entry;
+	entry.mask.compile(StringView(pattern));
+	choose_anchor(entry);
+	m_entries.push_back(entry);
+
+	// Keep the load factor under 1/2
+	if ((m_used_buckets + 1) * 2 > m_buckets.size())
+		rebuild();
+	else
+		file_entry(m_entries.size() - 1);
+}
+
+bool MaskIndex::remove(const std::string& pattern)
+{
+	std::size_t index = find_entry(pattern);
+	if (index == npos)
+		return false;
+
+	std::vector<std::size_t>& entries = get_bucket(m_entries[index].anchor, m_entries[index].gram).entries;
+	entries.erase(std::find(entries.begin(), entries.end(), index));
+
+	// The last entry takes the place of the removed one
+	std::size_t last = m_entries.size() - 1;
+	if (index != last) {
+		std::vector<std::size_t>& last_entries = get_bucket(m_entries[last].anchor, m_entries[last].gram).entries;
+		*std::find(last_entries.begin(), last_entries.end(), last) = index;
+		m_entries[index] = m_entries[last];
+	}
+	m_entries.pop_back();
+	return true;
+}
+
+bool MaskIndex::contains(const std::string& pattern) const
+{
+	return find_entry(pattern) != npos;
+}
+
+bool MaskIndex::matches(const StringView& name) const
+{
+	if (matches_bucket(UNINDEXED, 0, name))
+		return true;
+	if (name.size() < MASK_INDEX_GRAM_LENGTH)
+		return false;
+
+	if (matches_bucket(PREFIX, gram_at(name.data()), name))
+		return true;
+	if (matches_bucket(SUFFIX, gram_at(name.end() - MASK_INDEX_GRAM_LENGTH), name))
+		return true;
+
+	Gram gram = gram_at(name.data());
+	for (std::size_t i = MASK_INDEX_GRAM_LENGTH; true; i++) {
+		if (matches_bucket(INFIX, gram, name))
+			return true;
+		if (i == name.size())
+			return false;
+		gram = next_gram(gram, name[i]);
+	}
+}
+
+MaskIndex::Gram MaskIndex::next_gram(Gram gram, char c)
+{
+	// The oldest character is shifted out of the 32 bits
+	return static_cast<Gram>(gram << 8) | static_cast<unsigned char>(Casemapping::fold(c));
+}
+
+MaskIndex::Gram MaskIndex::gram_at(const char *str)
+{
+	Gram gram = 0;
+	for (std::size_t i = 0; i < MASK_INDEX_GRAM_LENGTH; i++)
+		gram = next_gram(gram, str[i]);
+	return gram;
+}
+
+std::size_t MaskIndex::bucket_position(Anchor anchor, Gram gram) const
+{
+	uint32_t hash = (gram + static_cast<uint32_t>(anchor) * 0x9E3779B9u) * 0x85EBCA6Bu;
+	return (hash ^ (hash >> 16)) & mask();
+}
+
+const MaskIndex::Bucket *MaskIndex::find_bucket(Anchor anchor, Gram gram) const
+{
+	for (std::size_t position = bucket_position(anchor, gram); m_buckets[position].is_used; position = (position + 1) & mask()) {
+		const Bucket& bucket = m_buckets[position];
+		if (bucket.anchor == anchor && bucket.gram == gram)
+			return &bucket;
+	}
+	return NULL;
+}
+
+std::size_t MaskIndex::bucket_load(Anchor anchor, Gram gram) const
+{
+	const Bucket *bucket = find_bucket(anchor, gram);
+	return bucket ? bucket->entries.size() : 0;
+}
+
+MaskIndex::Bucket& MaskIndex::get_bucket(Anchor anchor, Gram gram)
+{
+	std::size_t position = bucket_position(anchor, gram);
+	for (; m_buckets[position].is_used; position = (position + 1) & mask()) {
+		Bucket& bucket = m_buckets[position];
+		if (bucket.anchor == anchor && bucket.gram == gram)
+			return bucket;
+	}
+
+	Bucket& bucket = m_buckets[position];
+	bucket.is_used = true;
+	bucket.anchor = anchor;
+	bucket.gram = gram;
+	m_used_buckets++;
+	return bucket;
+}
+
+void MaskIndex::candidate_keys(const std::string& pattern, KeyVector& keys)
+{
+	keys.clear();
+	std::size_t run_start = 0;
+	for (std::size_t i = 0; i <= pattern.size(); i++) {
+		if (i < pattern.size() && pattern[i] != '*' && pattern[i] != '?')
+			continue ;
+
+		// A literal run is [run_start, i)
+		if (i - run_start >= MASK_INDEX_GRAM_LENGTH) {
+			if (run_start == 0)
+				keys.push_back(Key(PREFIX, gram_at(pattern.data())));
+			if (i == pattern.size())
+				keys.push_back(Key(SUFFIX, gram_at(pattern.data() + i - MASK_INDEX_GRAM_LENGTH)));
+			for (std::size_t start = run_start; start + MASK_INDEX_GRAM_LENGTH <= i; start++)
+				keys.push_back(Key(INFIX, gram_at(pattern.data() + start)));
+		}
+		run_start = i + 1;
+	}
+	keys.push_back(Key(UNINDEXED, 0));
+}
+
+std::size_t MaskIndex::find_entry(const std::string& pattern) const
+{
+	KeyVector keys;
+	candidate_keys(pattern, keys);
+	for (KeyVector::const_iterator key = keys.begin(); key != keys.end(); ++key) {
+		const Bucket *bucket = find_bucket(key->first, key->second);
+		if (!bucket)
+			continue ;
+		for (std::vector<std::size_t>::const_iterator it = bucket->entries.begin(); it != bucket->entries.end(); ++it) {
+			if (Casemapping::equals(m_entries[*it].mask.pattern(), pattern))
+				return *it;
+		}
+	}
+	return npos;
+}
+
+void MaskIndex::choose_anchor(Entry& entry) const
+{
+	KeyVector keys;
+	candidate_keys(entry.mask.pattern(), keys);
+
+	// The unindexed bucket is last, only taken when no literal run is long enough
+	std::size_t best = keys.size() - 1;
+	std::size_t best_load = static_cast<std::size_t>(-1);
+	for (std::size_t i = 0; i + 1 < keys.size(); i++) {
+		std::size_t load = bucket_load(keys[i].first, keys[i].second);
+		if (load < best_load) {
+			best = i;
+			best_load = load;
+		}
+	}
+	entry.anchor = keys[best].first;
+	entry.gram = keys[best].second;
+}
+
+void MaskIndex::file_entry(std::size_t index)
+{
+	get_bucket(m_entries[index].anchor, m_entries[index].gram).entries.push_back(index);
+}
+
+void MaskIndex::rebuild()
+{
+	// Sized for the entries, which also drops the buckets left empty by removals
+	std::size_t bucket_count = MASK_INDEX_MIN_BUCKETS;
+	while (bucket_count < m_entries.size() * 4)
+		bucket_count *= 2;
+
+	m_buckets.assign(bucket_count, Bucket());
+	m_used_buckets = 0;
+	for (std::size_t i = 0; i < m_entries.size(); i++)
+		file_entry(i);
+}
+
+bool MaskIndex::matches_bucket(Anchor anchor, Gram gram, const StringView& name) const
+{
+	const Bucket *bucket = find_bucket(anchor, gram);
+	if (!bucket)
+		return false;
+
+	for (std::vector<std::size_t>::const_iterator it = bucket->entries.begin(); it != bucket->entries.end(); ++it) {
+		if (m_entries[*it].mask.matches(name))
+			return true;
+	}
+	return false;
+}
@@ -0,0 +1,99 @@
+//
+// Created by nathan on 4/10/23.
+//
+
+#ifndef MASKINDEX_H
+#define MASKINDEX_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <utility>
+#include <stdint.h>
+#include "StringView.h"
+#include "Hostmask.h"
+
+#define MASK_INDEX_GRAM_LENGTH 4
+
+// Wildcard masks indexed by their literal parts, so that a name is only
+//  matched against the few masks that could match it. A mask only matches
+//  names containing each of its literal runs (the characters between the
+//  wildcards), so it is filed under one gram of MASK_INDEX_GRAM_LENGTH
+//  characters taken from them:
+//  - its literal prefix, looked up with the first gram of the name
+//  - its literal suffix, looked up with the last gram of the name
+//  - any gram of its runs, looked up with every gram of the name
+//  The mask goes to the bucket holding the fewest masks, so lists sharing
+//  a common part ("spammer*", "*!*@10.*") still spread out. The few masks
+//  without a long enough run are matched one by one.
+//  Adding or removing a mask only updates its bucket.
+class MaskIndex
+{
+public:
+	MaskIndex();
+
+	/// The pattern must not be in the index already
+	void	add(const std::string& pattern);
+	bool	remove(const std::string& pattern);
+	bool	contains(const std::string& pattern)	const;
+	bool	matches(const StringView& name)			const;
+
+	std::size_t	size()	const { return m_entries.size(); }
+	bool		empty()	const { return m_entries.empty(); }
+
+private:
+	typedef uint32_t	Gram;
+
+	enum Anchor
+	{
+		PREFIX,
+		SUFFIX,
+		INFIX,
+		UNINDEXED
+	};
+
+	struct Entry
+	{
+		Hostmask	mask;
+		Anchor		anchor;
+		Gram		gram;
+	};
+
+	struct Bucket
+	{
+		Bucket() : is_used(false), anchor(UNINDEXED), gram(0) {}
+
+		bool						is_used;
+		Anchor						anchor;
+		Gram						gram;
+		std::vector<std::size_t>	entries;
+	};
+
+	// Every bucket the pattern could be filed under, the unindexed one last
+	typedef std::pair<Anchor, Gram>	Key;
+	typedef std::vector<Key>		KeyVector;
+
+	static const std::size_t	npos;
+
+	static Gram	next_gram(Gram gram, char c);
+	static Gram	gram_at(const char *str);
+	static void	candidate_keys(const std::string& pattern, KeyVector& keys);
+
+	// Open addressing with linear probing, buckets are kept once used until the next rebuild
+	std::size_t		mask()	const { return m_buckets.size() - 1; }
+	std::size_t		bucket_position(Anchor anchor, Gram gram)	const;
+	const Bucket	*find_bucket(Anchor anchor, Gram gram)		const;
+	std::size_t		bucket_load(Anchor anchor, Gram gram)		const;
+	Bucket&			get_bucket(Anchor anchor, Gram gram);
+	std::size_t		find_entry(const std::string& pattern)		const;
+	void			choose_anchor(Entry& entry)					const;
+	void			file_entry(std::size_t index);
+	void			rebuild();
+	bool			matches_bucket(Anchor anchor, Gram gram, const StringView& name)	const;
+
+	std::vector<Entry>	m_entries;
+	std::vector<Bucket>	m_buckets;
+	std::size_t			m_used_buckets;
+};
+
+#endif //MASKINDEX_H
@@ -0,0 +1,98 @@
+//
+// Created by nathan on 4/10/23.
+//
+
+#include "MaskList.h"
+#include "Casemapping.h"
+
+#define MASK_LIST_MIN_SLOTS 8
+
+const std::size_t MaskList::npos = static_cast<std::size_t>(-1);
+
+struct MaskList::SameEntry
+{
+	SameEntry(const EntryVector& exact_entries, const StringView& searched_entry) : entries(exact_entries), entry(searched_entry) {}
+
+	bool operator()(const Slot& slot) const { return Casemapping::equals(StringView(entries[slot.index]), entry); }
+
+	const EntryVector&	entries;
+	StringView			entry;
+};
+
+MaskList::MaskList() : m_slots(MASK_LIST_MIN_SLOTS)
+{
+}
+
+bool MaskList::add(const std::string& mask)
+{
+	if (contains(mask))
+		return false;
+
+	m_entries.push_back(mask);
+	if (Hostmask::has_wildcards(StringView(mask))) {
+		m_wildcard_index.add(mask);
+		return true;
+	}
+
+	m_exact_entries.push_back(mask);
+	insert_slot(m_exact_entries.size() - 1);
+	return true;
+}
+
+bool MaskList::remove(const std::string& mask)
+{
+	EntryVector::iterator entry = m_entries.begin();
+	while (entry != m_entries.end() && !Casemapping::equals(*entry, mask))
+		entry++;
+	if (entry == m_entries.end())
+		return false;
+	m_entries.erase(entry);
+
+	if (Hostmask::has_wildcards(StringView(mask))) {
+		m_wildcard_index.remove(mask);
+		return true;
+	}
+
+	for (entry = m_exact_entries.begin(); entry != m_exact_entries.end(); entry++) {
+		if (Casemapping::equals(*entry, mask)) {
+			m_exact_entries.erase(entry);
+			break ;
+		}
+	}
+	// The indexes after the removed entry moved, and removals are rare
+	rebuild_slots();
+	return true;
+}
+
+bool MaskList::contains(const std::string& mask) const
+{
+	if (!Hostmask::has_wildcards(StringView(mask)))
+		return find_exact(StringView(mask)) != npos;
+	return m_wildcard_index.contains(mask);
+}
+
+bool MaskList::matches(const StringView& name) const
+{
+	if (find_exact(name) != npos)
+		return true;
+	return m_wildcard_index.matches(name);
+}
+
+std::size_t MaskList::find_exact(const StringView& entry) const
+{
+	std::size_t slot = m_slots.find(Casemapping::hash(entry), SameEntry(m_exact_entries, entry));
+	return slot == m_slots.npos ? npos : m_slots[slot].index;
+}
+
+void MaskList::insert_slot(std::size_t exact_index)
+{
+	Slot slot = { exact_index, Casemapping::hash(StringView(m_exact_entries[exact_index])) };
+	m_slots.insert(slot);
+}
+
+void MaskList::rebuild_slots()
+{
+	m_slots.clear();
+	for (std::size_t i = 0; i < m_exact_entries.size(); i++)
+		insert_slot(i);
+}
@@ -0,0 +1,72 @@
+//
+// Created by nathan on 4/10/23.
+//
+
+#ifndef MASKLIST_H
+#define MASKLIST_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include "StringView.h"
+#include "MaskIndex.h"
+#include "HashSlots.h"
+
+// List of masks of a channel (+b, +e, +I and invites). The entries are kept
+//  in insertion order for the list replies, and split for the lookups:
+//  exact entries go in a case-folded hash set, and the entries with
+//  wildcards ('*' and '?') in a MaskIndex, which only tries the masks
+//  sharing a literal part with the name.
+class MaskList
+{
+public:
+	typedef std::vector<std::string>	EntryVector;
+
+	MaskList();
+
+	/// Both return false if nothing changed: the entry was already present,
+	///  or missing. Entries are compared with the server's Casemapping.
+	bool	add(const std::string& mask);
+	bool	remove(const std::string& mask);
+	bool	contains(const std::string& mask)	const;
+
+	/// Whether the name is one of the exact entries or matches a wildcard mask
+	bool	matches(const StringView& name)		const;
+	bool	matches(const std::string& name)	const { return matches(StringView(name)); }
+
+	const EntryVector&	entries()	const { return m_entries; }
+	std::size_t			size()		const { return m_entries.size(); }
+	bool				empty()		const { return m_entries.empty(); }
+
+private:
+	// Index into m_exact_entries, with the hash of the entry
+	struct Slot
+	{
+		std::size_t	index;
+		std::size_t	hash;
+	};
+
+	struct SlotTraits
+	{
+		typedef MaskList::Slot	Slot;
+
+		static Slot			empty_slot()				{ Slot slot = { MaskList::npos, 0 }; return slot; }
+		static bool			is_empty(const Slot& slot)	{ return slot.index == MaskList::npos; }
+		static std::size_t	hash(const Slot& slot)		{ return slot.hash; }
+	};
+
+	struct SameEntry;
+
+	static const std::size_t	npos;
+
+	std::size_t	find_exact(const StringView& entry)	const;
+	void		insert_slot(std::size_t exact_index);
+	void		rebuild_slots();
+
+	EntryVector				m_entries;
+	EntryVector				m_exact_entries;
+	HashSlots<SlotTraits>	m_slots;
+	MaskIndex				m_wildcard_index;
+};
+
+#endif //MASKLIST_H
@@ -33,8 +33,10 @@ int cap(User& user, const Command& command)
 			user.set_is_negociating_capabilities(true);
 	}
 	else if (command.get_parameters()[0] == "REQ") {
-		if (command.get_parameters()[1] == "multi-prefix")
+		if (command.get_parameters()[1] == "multi-prefix") {
+			user.set_has_multi_prefix(true);
 			Server::reply(user, RPL_CAP(user, "ACK", "multi-prefix"));
+		}
 		if (!user.is_registered())
 			user.set_is_negociating_capabilities(true);
 	}
@@ -70,7 +72,7 @@ int nick(User& user, const Command& command)
 
 	const std::string& requested_nickname = command.get_parameters()[0];
 
-	if (to_upper(requested_nickname) == user.nickname_upper())
+	if (Casemapping::equals(requested_nickname, user.nickname()))
 		return 0;
 
 	if (!User::is_nickname_valid(requested_nickname)) {
@@ -361,10 +363,7 @@ int join(User& user, const Command& command)
 		}
 
 		// Notify all users of the channel of the newcomer
-		for (Channel::UserIterator channel_user_it = channel.users().begin(); channel_user_it != channel.users().end(); channel_user_it++) {
-			User& connected_user = get_user_reference(channel_user_it);
-			Server::reply(connected_user, USER_SOURCE("JOIN", user) + " " + channel.name());
-		}
+		Server::broadcast_to_channel(channel, USER_SOURCE("JOIN", user) + " " + channel.name());
 
 		CORE_INFO("User %s joined the channel %s", user.debug_name(), channel.name().c_str());
 		user.add_channel(channel);
@@ -779,11 +778,11 @@ int invite(User& user, const Command& command)
 		return 1;
 	}
 
-	if (!channel.is_user_invited_or_exempted(command.get_parameters()[0]))
-		channel.add_to_invitelist(command.get_parameters()[0]);
-
 	User& target_user = get_user_reference(target_user_it);
 
+	if (!channel.is_user_invited_or_exempted(target_user))
+		channel.add_to_invitelist(command.get_parameters()[0]);
+
 	Server::reply(user, RPL_INVITING(user, target_user.nickname(), channel.name()));
 	Server::reply(get_user_reference(target_user_it), USER_SOURCE("INVITE", user) + " " + target_user.nickname() + " :" + channel.name());
 	return 0;
@@ -945,6 +944,11 @@ int lusers(User& user, const Command& command)
 
 }
 
+static bool has_more_command_time(CommandId lhs, CommandId rhs)
+{
+	return Server::command_stats(lhs).latency.total() > Server::command_stats(rhs).latency.total();
+}
+
 int stats(User& user, const Command& command)
 {
 	//  https://www.rfc-editor.org/rfc/rfc2812#section-3.4.4
@@ -967,16 +971,52 @@ int stats(User& user, const Command& command)
 			}
 		} break;
 		case 'm': {
-			for (Server::CommandStatsIterator command_it = Server::commands_stats().begin();
-				 command_it != Server::commands_stats().end(); command_it++) {
-				if (command_it->second != 0) {
-					Server::reply(user, RPL_STATSCOMMANDS(user, command_it));
-				}
+			for (int i = 0; i < COMMAND_COUNT; i++) {
+				CommandId id = static_cast<CommandId>(i);
+				const CommandStats& command_stats = Server::command_stats(id);
+				if (command_stats.count != 0)
+					Server::reply(user, RPL_STATSCOMMANDS(user, CommandTable::name(id), command_stats.count, command_stats.bytes_in));
 			}
 		} break;
 		case 'o': {
 			Server::reply(user, RPL_STATSOLINE(user));
 		} break;
+		case 'p': {
+			// Where the event loop spends its time, only for the operators
+			if (!user.is_operator()) {
+				Server::reply(user, ERR_NOPRIVILEGES(user));
+				break ;
+			}
+			std::vector<std::string> lines;
+			Server::tick_profiler().summarize(lines);
+			for (std::vector<std::string>::iterator line_it = lines.begin(); line_it != lines.end(); line_it++)
+				Server::reply(user, RPL_STATSTICKS(user, *line_it));
+		} break;
+		case 't': {
+			// Time spent in each command handler, the costliest first
+			std::vector<CommandId> ids;
+			for (int i = 0; i < COMMAND_COUNT; i++) {
+				if (Server::command_stats(static_cast<CommandId>(i)).count != 0)
+					ids.push_back(static_cast<CommandId>(i));
+			}
+			std::sort(ids.begin(), ids.end(), has_more_command_time);
+			for (std::vector<CommandId>::iterator id_it = ids.begin(); id_it != ids.end(); id_it++)
+				Server::reply(user, RPL_STATSLATENCY(user, CommandTable::name(*id_it), Server::command_stats(*id_it)));
+		} break;
+		case 'z': {
+			// Output waiting in the connections' send queues
+			std::size_t queued_bytes = 0, queued_messages = 0, queued_connections = 0, largest = 0, peak = 0;
+			for (Server::UserIterator user_it = Server::users().begin(); user_it != Server::users().end(); user_it++) {
+				const OutputQueue& queue = get_user_reference(user_it).write_buffer();
+				queued_bytes += queue.size();
+				queued_messages += queue.message_count();
+				queued_connections += queue.empty() ? 0 : 1;
+				largest = std::max(largest, queue.size());
+				peak = std::max(peak, queue.peak_size());
+			}
+			Server::reply(user, RPL_STATSSENDQ(user, queued_bytes, queued_messages, queued_connections, largest, peak));
+			Server::reply(user, RPL_STATSSENDQEXCEEDED(user, Server::sendq_exceeded_count()));
+		} break;
 		case 'u': {
 			std::time_t uptime = time(NULL) - Server::start_timestamp();
 			Server::reply(user, RPL_STATSUPTIME(user, uptime));
@@ -0,0 +1,63 @@
+//
+// Created by nathan on 4/9/23.
+//
+
+#include "NicknameIndex.h"
+#include "User.h"
+#include "Casemapping.h"
+#include "log.h"
+
+// Small enough for the index of each channel, the tables grow with the users
+#define NICKNAME_INDEX_MIN_SLOTS 8
+
+struct NicknameIndex::SameUser
+{
+	explicit SameUser(const User *searched_user) : user(searched_user) {}
+
+	bool operator()(const Slot& slot) const { return slot.user == user; }
+
+	const User	*user;
+};
+
+struct NicknameIndex::SameNickname
+{
+	SameNickname(const StringView& searched_nickname, std::size_t nickname_hash) : nickname(searched_nickname), hash(nickname_hash) {}
+
+	bool operator()(const Slot& slot) const {
+		return slot.hash == hash && Casemapping::equals(StringView(slot.user->nickname()), nickname);
+	}
+
+	StringView	nickname;
+	std::size_t	hash;
+};
+
+NicknameIndex::NicknameIndex() : m_slots(NICKNAME_INDEX_MIN_SLOTS)
+{
+}
+
+void NicknameIndex::insert(User& user)
+{
+	if (find(user.nickname())) {
+		CORE_WARN("Nickname %s is already indexed", user.nickname().c_str());
+		return ;
+	}
+
+	Slot slot = { &user, Casemapping::hash(StringView(user.nickname())) };
+	m_slots.insert(slot);
+}
+
+bool NicknameIndex::remove(const User& user)
+{
+	std::size_t position = m_slots.find(Casemapping::hash(StringView(user.nickname())), SameUser(&user));
+	if (position == m_slots.npos)
+		return false;
+	m_slots.remove(position);
+	return true;
+}
+
+User* NicknameIndex::find(const StringView& nickname) const
+{
+	std::size_t nickname_hash = Casemapping::hash(nickname);
+	std::size_t position = m_slots.find(nickname_hash, SameNickname(nickname, nickname_hash));
+	return position == m_slots.npos ? NULL : m_slots[position].user;
+}
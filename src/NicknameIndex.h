@@ -0,0 +1,57 @@
+//
+// Created by nathan on 4/9/23.
+//
+
+#ifndef NICKNAMEINDEX_H
+#define NICKNAMEINDEX_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include "StringView.h"
+#include "HashSlots.h"
+
+class User;
+
+// Hash index of users by case-folded nickname, following the server's
+//  Casemapping. The nicknames aren't copied: lookups fold the characters on
+//  the fly and compare them with the user's own nickname, so a user must be
+//  removed before its nickname changes and inserted back afterwards.
+class NicknameIndex
+{
+public:
+	NicknameIndex();
+
+	void	insert(User& user);
+	bool	remove(const User& user);
+	User*	find(const StringView& nickname)	const;
+	User*	find(const std::string& nickname)	const { return find(StringView(nickname)); }
+
+	std::size_t	size()	const { return m_slots.size(); }
+	bool		empty()	const { return m_slots.empty(); }
+	void		clear()		  { m_slots.clear(); }
+
+private:
+	// The hash is kept to skip most compares
+	struct Slot
+	{
+		User		*user;
+		std::size_t	hash;
+	};
+
+	struct SlotTraits
+	{
+		typedef NicknameIndex::Slot	Slot;
+
+		static Slot			empty_slot()				{ Slot slot = { NULL, 0 }; return slot; }
+		static bool			is_empty(const Slot& slot)	{ return slot.user == NULL; }
+		static std::size_t	hash(const Slot& slot)		{ return slot.hash; }
+	};
+
+	struct SameUser;
+	struct SameNickname;
+
+	HashSlots<SlotTraits>	m_slots;
+};
+
+#endif //NICKNAMEINDEX_H
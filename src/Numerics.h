@@ -25,11 +25,18 @@
 														+ to_string(user.write_buffer().size()) + " " + to_string(user.sent_messages_count()) + " " + to_string(user.data_sent_size() / 1000) \
 														+ " " + to_string(user.received_messages_count()) + " " + to_string(user.data_received_size() / 1000) \
 														+ " " + to_string(user.time_connexion_open()))
-#define RPL_STATSCOMMANDS(user, command_stats)			(SERVER_SOURCE("212", user) + " " + command_stats->first + " " + to_string(command_stats->second) + " 0 :0")
+#define RPL_STATSCOMMANDS(user, name, count, bytes)	(SERVER_SOURCE("212", user) + " " + name + " " + to_string(count) + " " + to_string(bytes) + " :0")
 #define RPL_ENDOFSTATS(user, query_char)				(SERVER_SOURCE("219", user) + " " + query_char + " :End of STATS report")
 #define RPL_UMODEIS(user)								(SERVER_SOURCE("221", user) + " " + user.get_modes_as_str())
 
 #define RPL_STATSUPTIME(user, seconds)					(SERVER_SOURCE("242", user) + " :Server Up " + to_string(seconds / 86400) + " days " + to_string(seconds / 3600) + ":" + to_string(seconds / 60) + ":" + to_string(seconds % 60))
+#define RPL_STATSSENDQ(user, bytes, messages, connections, largest, peak)	(SERVER_SOURCE("249", user) + " z :SendQ " + to_string(bytes) + " bytes in " + to_string(messages) + " messages on " + to_string(connections) \
+														+ " connections, largest " + to_string(largest) + " bytes, peak " + to_string(peak) + " bytes")
+#define RPL_STATSSENDQEXCEEDED(user, count)			(SERVER_SOURCE("249", user) + " z :SendQ exceeded " + to_string(count) + " times")
+#define RPL_STATSLATENCY(user, name, stats)				(SERVER_SOURCE("249", user) + " t :" + name + " " + to_string(stats.count) + " calls, p50 " + format_duration(stats.latency.percentile(0.5)) \
+														+ " p99 " + format_duration(stats.latency.percentile(0.99)) + " max " + format_duration(stats.latency.max()) \
+														+ " total " + format_duration(stats.latency.total()) + ", " + to_string(stats.bytes_in) + " bytes in " + to_string(stats.bytes_out) + " bytes out")
+#define RPL_STATSTICKS(user, line)						(SERVER_SOURCE("249", user) + " p :" + line)
 #define RPL_STATSOLINE(user)							(SERVER_SOURCE("243", user) + " O *@127.0.0.1 * " + Server::operator_name())
 #define RPL_LUSERCLIENT(user, current, nbr_invisible)	(SERVER_SOURCE("251", user) + " :There are " + current + " users and " + nbr_invisible + " invisible on 1 server")
 #define RPL_LUSEROP(user, nbr_operator)					(SERVER_SOURCE("252", user) + " " + nbr_operator + " :IRC operator(s) online")
@@ -83,7 +90,7 @@
 #define RPL_ENDOFEXCEPTLIST(user, channel)				(SERVER_SOURCE("349", user) + " " + channel.name() + " :End of channel exception list")
 #define RPL_VERSION(user, comment)						(SERVER_SOURCE("351", user) + " " + Server::info().version() + " " + Server::info().name() + " :" + comment)
 
-#define RPL_NAMREPLY(user, chan, chan_user, chan_user_perms)	(SERVER_SOURCE("353", user) + " " + chan.status() + " " + chan.name() + " :" + chan_user_perms.get_highest_prefix() + chan_user.nickname())
+#define RPL_NAMREPLY(user, chan, chan_user, chan_user_perms)	(SERVER_SOURCE("353", user) + " " + chan.status() + " " + chan.name() + " :" + chan_user_perms.prefixes(user.has_multi_prefix()) + chan_user.nickname())
 #define RPL_ENDOFNAMES(user, channel)							(SERVER_SOURCE("366", user) + " " + channel + " :End of /NAMES list.")
 
 #define RPL_LINKS 364
@@ -0,0 +1,142 @@
+//
+// Created by nathan on 4/3/23.
+//
+
+#include "OldUserList.h"
+#include "User.h"
+#include "Casemapping.h"
+
+#define OLD_USER_LIST_MIN_SLOTS 64
+
+OldUserInfo::OldUserInfo(std::time_t time, const User &user)
+	: m_last_time_seen(time), m_nickname(user.nickname()),
+	m_username(user.username()), m_realname(user.realname()), m_host(user.ip()),
+	m_sequence(0), m_previous(0), m_is_forgotten(false)
+{
+}
+
+bool OldUserInfo::operator==(const User &user) const
+{
+	return Casemapping::equals(m_nickname, user.nickname()) && m_username == user.username() && m_realname == user.realname() && m_host == user.ip();
+}
+
+bool OldUserInfo::operator==(const OldUserInfo &user) const
+{
+	return Casemapping::equals(m_nickname, user.nickname()) && m_username == user.username() && m_realname == user.realname() && m_host == user.host();
+}
+
+struct OldUserList::SameNickname
+{
+	SameNickname(const OldUserList& old_users, const StringView& searched_nickname, std::size_t nickname_hash) :
+		list(old_users), nickname(searched_nickname), hash(nickname_hash) {}
+
+	bool operator()(const Slot& slot) const {
+		return slot.hash == hash && Casemapping::equals(StringView(list.entry(slot.sequence)->nickname()), nickname);
+	}
+
+	const OldUserList&	list;
+	StringView			nickname;
+	std::size_t			hash;
+};
+
+OldUserList::OldUserList() : m_index(OLD_USER_LIST_MIN_SLOTS), m_next_sequence(1)
+{
+}
+
+void OldUserList::add(const OldUserInfo& user)
+{
+	forget(user);
+
+	m_entries.push_back(user);
+	OldUserInfo& new_entry = m_entries.back();
+	new_entry.m_sequence = m_next_sequence++;
+	new_entry.m_previous = 0;
+	new_entry.m_is_forgotten = false;
+
+	// The new entry becomes the head of its nickname's chain
+	std::size_t hash = Casemapping::hash(StringView(user.nickname()));
+	std::size_t slot = find_slot(StringView(user.nickname()), hash);
+	if (slot != m_index.npos) {
+		new_entry.m_previous = m_index[slot].sequence;
+		m_index[slot].sequence = new_entry.m_sequence;
+	} else {
+		Slot new_slot = { new_entry.m_sequence, hash };
+		m_index.insert(new_slot);
+	}
+
+	if (m_entries.size() > OLD_USER_LIST_MAX_SIZE)
+		remove_oldest();
+}
+
+bool OldUserList::forget(const OldUserInfo& user)
+{
+	std::size_t slot = find_slot(StringView(user.nickname()), Casemapping::hash(StringView(user.nickname())));
+	if (slot == m_index.npos)
+		return false;
+
+	OldUserInfo *newer = NULL;
+	for (OldUserInfo *old_user = entry(m_index[slot].sequence); old_user; newer = old_user, old_user = entry(old_user->m_previous)) {
+		if (!(*old_user == user))
+			continue ;
+
+		// Unlink the entry from its chain, it ages out with the others
+		if (newer)
+			newer->m_previous = old_user->m_previous;
+		else if (entry(old_user->m_previous))
+			m_index[slot].sequence = old_user->m_previous;
+		else
+			m_index.remove(slot);
+		old_user->m_is_forgotten = true;
+		return true;
+	}
+	return false;
+}
+
+bool OldUserList::contains(const OldUserInfo& user) const
+{
+	for (const OldUserInfo *old_user = find(user.nickname()); old_user; old_user = find_previous(*old_user)) {
+		if (*old_user == user)
+			return true;
+	}
+	return false;
+}
+
+const OldUserInfo *OldUserList::find(const std::string& nickname) const
+{
+	std::size_t slot = find_slot(StringView(nickname), Casemapping::hash(StringView(nickname)));
+	return slot == m_index.npos ? NULL : entry(m_index[slot].sequence);
+}
+
+const OldUserInfo *OldUserList::find_previous(const OldUserInfo& user) const
+{
+	return entry(user.m_previous);
+}
+
+OldUserInfo *OldUserList::entry(uint64_t sequence)
+{
+	if (sequence == 0 || m_entries.empty() || sequence < m_entries.front().m_sequence)
+		return NULL;
+	return &m_entries[static_cast<std::size_t>(sequence - m_entries.front().m_sequence)];
+}
+
+const OldUserInfo *OldUserList::entry(uint64_t sequence) const
+{
+	return const_cast<OldUserList *>(this)->entry(sequence);
+}
+
+std::size_t OldUserList::find_slot(const StringView& nickname, std::size_t hash) const
+{
+	return m_index.find(hash, SameNickname(*this, nickname, hash));
+}
+
+void OldUserList::remove_oldest()
+{
+	// The older entries of a chain are dropped by entry(), only a head is indexed
+	const OldUserInfo& oldest = m_entries.front();
+	if (!oldest.m_is_forgotten) {
+		std::size_t slot = find_slot(StringView(oldest.nickname()), Casemapping::hash(StringView(oldest.nickname())));
+		if (slot != m_index.npos && m_index[slot].sequence == oldest.m_sequence)
+			m_index.remove(slot);
+	}
+	m_entries.pop_front();
+}
@@ -0,0 +1,116 @@
+//
+// Created by nathan on 4/3/23.
+//
+
+#ifndef OLDUSERLIST_H
+#define OLDUSERLIST_H
+
+#include <deque>
+#include <string>
+#include <ctime>
+#include <cstddef>
+#include <stdint.h>
+#include "StringView.h"
+#include "HashSlots.h"
+
+#define OLD_USER_LIST_MAX_SIZE 5000
+
+class User;
+
+struct OldUserInfo
+{
+	OldUserInfo() : m_last_time_seen(0), m_sequence(0), m_previous(0), m_is_forgotten(false) {}
+	OldUserInfo(std::time_t time, const User& user);
+
+	bool operator==(const User& user) const;
+	bool operator==(const OldUserInfo& user) const;
+
+	      std::time_t	time_last_seen()	const { return m_last_time_seen; }
+	const std::string&	nickname()			const { return m_nickname; }
+	const std::string&	username()			const { return m_username; }
+	const std::string&	realname()			const { return m_realname; }
+	const std::string&	host()				const { return m_host; }
+	      bool			is_forgotten()		const { return m_is_forgotten; }
+
+	void set_time_last_seen(std::time_t value)	{ m_last_time_seen = value; }
+	void set_nickname(const std::string& value)	{ m_nickname = value; }
+	void set_username(const std::string& value)	{ m_username = value; }
+	void set_realname(const std::string& value)	{ m_realname = value; }
+	void set_host(const std::string& value)		{ m_host = value; }
+
+	std::time_t m_last_time_seen;
+	std::string m_nickname;
+	std::string m_username;
+	std::string m_realname;
+	std::string m_host;
+
+private:
+	friend class OldUserList;
+
+	// Set by the OldUserList: the sequence number of the entry, and the one of
+	//  the previous entry with the same nickname, 0 for none
+	uint64_t	m_sequence;
+	uint64_t	m_previous;
+	bool		m_is_forgotten;
+};
+
+// History of the users that left the server or changed their nickname, for
+//  WHOWAS and config/user_list.csv. The newest OLD_USER_LIST_MAX_SIZE entries
+//  are kept in a FIFO, and those of each nickname are chained from the newest
+//  one, found through a hash index keyed by the case-folded nickname: adding,
+//  forgetting or looking up a user only goes through the entries of its
+//  nickname. A forgotten entry is unlinked from its chain but stays in the
+//  FIFO, skipped, until it ages out.
+class OldUserList
+{
+public:
+	typedef std::deque<OldUserInfo>	EntryDeque;
+
+	OldUserList();
+
+	/// Replaces the entry of the same user (nickname, username, realname and
+	///  host) if there is one, the oldest entry ages out when the list is full
+	void				add(const OldUserInfo& user);
+	/// Returns false if there was no entry for this user
+	bool				forget(const OldUserInfo& user);
+	bool				contains(const OldUserInfo& user)	const;
+
+	/// Newest entry of the nickname, NULL if there is none
+	const OldUserInfo	*find(const std::string& nickname)	const;
+	/// Next older entry with the same nickname, NULL if there is none
+	const OldUserInfo	*find_previous(const OldUserInfo& user)	const;
+
+	/// Forgotten entries included, in the order they were added
+	const EntryDeque&	entries()	const { return m_entries; }
+	std::size_t			size()		const { return m_entries.size(); }
+
+private:
+	struct Slot
+	{
+		uint64_t	sequence;
+		std::size_t	hash;
+	};
+
+	struct SlotTraits
+	{
+		typedef OldUserList::Slot	Slot;
+
+		static Slot			empty_slot()				{ Slot slot = { 0, 0 }; return slot; }
+		static bool			is_empty(const Slot& slot)	{ return slot.sequence == 0; }
+		static std::size_t	hash(const Slot& slot)		{ return slot.hash; }
+	};
+
+	struct SameNickname;
+
+	/// NULL for 0 and for the entries that aged out
+	OldUserInfo			*entry(uint64_t sequence);
+	const OldUserInfo	*entry(uint64_t sequence)	const;
+	std::size_t			find_slot(const StringView& nickname, std::size_t hash)	const;
+	void				remove_oldest();
+
+	EntryDeque				m_entries;
+	HashSlots<SlotTraits>	m_index;
+	uint64_t				m_next_sequence;
+};
+
+#endif //OLDUSERLIST_H
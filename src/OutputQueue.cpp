@@ -0,0 +1,72 @@
+//
+// Created by nathan on 4/5/23.
+//
+
+#include <climits>
+#include <sys/uio.h>
+#include "OutputQueue.h"
+
+// Most messages to write in a single writev() call
+#ifdef IOV_MAX
+# define OUTPUT_QUEUE_IOVEC_COUNT IOV_MAX
+#else
+# define OUTPUT_QUEUE_IOVEC_COUNT 1024
+#endif
+
+OutputQueue::OutputQueue() : m_offset(0), m_size(0), m_peak_size(0)
+{
+}
+
+void OutputQueue::push(const SharedMessage& message)
+{
+	if (message.empty())
+		return ;
+	m_messages.push_back(message);
+	m_size += message.size();
+	if (m_size > m_peak_size)
+		m_peak_size = m_size;
+}
+
+void OutputQueue::clear()
+{
+	if (m_offset == 0) {
+		m_messages.clear();
+		m_size = 0;
+		return ;
+	}
+	m_messages.erase(m_messages.begin() + 1, m_messages.end());
+	m_size = m_messages.front().size() - m_offset;
+}
+
+ssize_t OutputQueue::write_to(int fd)
+{
+	iovec chunks[OUTPUT_QUEUE_IOVEC_COUNT];
+	int chunk_count = 0;
+
+	for (MessageQueue::const_iterator it = m_messages.begin(); it != m_messages.end() && chunk_count < OUTPUT_QUEUE_IOVEC_COUNT; it++) {
+		std::size_t offset = chunk_count == 0 ? m_offset : 0;
+		chunks[chunk_count].iov_base = const_cast<char *>(it->data() + offset);
+		chunks[chunk_count].iov_len = it->size() - offset;
+		chunk_count++;
+	}
+
+	ssize_t bytes_written = writev(fd, chunks, chunk_count);
+	if (bytes_written > 0)
+		consume(static_cast<std::size_t>(bytes_written));
+	return bytes_written;
+}
+
+void OutputQueue::consume(std::size_t length)
+{
+	m_size -= length;
+	while (length > 0) {
+		std::size_t left_in_message = m_messages.front().size() - m_offset;
+		if (length < left_in_message) {
+			m_offset += length;
+			return ;
+		}
+		length -= left_in_message;
+		m_offset = 0;
+		m_messages.pop_front();
+	}
+}
@@ -0,0 +1,45 @@
+//
+// Created by nathan on 4/5/23.
+//
+
+#ifndef OUTPUTQUEUE_H
+#define OUTPUTQUEUE_H
+
+#include <deque>
+#include <cstddef>
+#include <sys/types.h>
+#include "SharedMessage.h"
+
+// Queue of the messages waiting to be sent to a connection. The messages
+//  are only referenced and written together with writev(), up to IOV_MAX
+//  at a time, and a partial write just moves the offset in the first one.
+class OutputQueue
+{
+public:
+	OutputQueue();
+
+	void		push(const SharedMessage& message);
+	/// Drops the queued messages, except the one that was partially sent
+	void		clear();
+
+	/// Writes as much as possible, same return value as write()
+	ssize_t		write_to(int fd);
+
+	std::size_t	size()			const	{ return m_size; }
+	bool		empty()			const	{ return m_size == 0; }
+	std::size_t	message_count()	const	{ return m_messages.size(); }
+	std::size_t	peak_size()		const	{ return m_peak_size; }
+
+private:
+	typedef std::deque<SharedMessage>	MessageQueue;
+
+	void		consume(std::size_t length);
+
+	MessageQueue	m_messages;
+	// Bytes of the first message that were already sent
+	std::size_t		m_offset;
+	std::size_t		m_size;
+	std::size_t		m_peak_size;
+};
+
+#endif //OUTPUTQUEUE_H
@@ -4,6 +4,8 @@
 
 #include <arpa/inet.h>
 #include <cerrno>
+#include <climits>
+#include <cstdlib>
 #include <fcntl.h>
 #include <unistd.h>
 #include <algorithm>
@@ -15,9 +17,22 @@
 #include "Numerics.h"
 #include "Message.h"
 #include "ParamSplitter.h"
+#include "Journal.h"
 
-const int			Server::m_server_backlog = 10;
 const int			Server::m_timeout = 20;
+int					Server::m_listen_backlog = 128;
+std::size_t			Server::m_accept_batch_size = 64;
+std::size_t			Server::m_commands_per_tick = 10;
+std::size_t			Server::m_max_sendq = 1024 * 1024;
+std::size_t			Server::m_oper_max_sendq = 8 * 1024 * 1024;
+std::size_t			Server::m_max_lists_entries = 20;
+std::string			Server::m_log_file;
+std::string			Server::m_journal_file;
+std::size_t			Server::m_journal_file_size = 64 * 1024 * 1024;
+std::size_t			Server::m_journal_file_count = 4;
+std::size_t			Server::m_sendq_exceeded_count = 0;
+TickProfiler		Server::m_tick_profiler;
+volatile sig_atomic_t	Server::m_is_tick_profile_requested = 0;
 
 ServerInfo			Server::m_server_info;
 int					Server::m_server_socket;
@@ -29,54 +44,52 @@ std::string			Server::m_oper_password;
 std::string			Server::m_oper_username;
 std::string			Server::m_oper_host;
 
-std::vector<pollfd>	Server::m_pollfds;
+EventBackend		Server::m_event_backend;
+bool				Server::m_is_server_socket_readable = false;
 
 size_t				Server::m_unknown_connections = 0;
 
-Server::UserVector								Server::m_users;
-Server::OldUserVector							Server::m_old_users;
+ConnectionTable									Server::m_users;
+NicknameIndex									Server::m_nicknames;
+Server::UserVector								Server::m_users_to_flush;
+Server::UserVector								Server::m_users_to_remove;
+Server::UserVector								Server::m_users_with_commands;
+Server::UserVector								Server::m_users_running_commands;
+OldUserList										Server::m_old_users;
 Server::ChannelMap								Server::m_channels;
-std::map<std::string, Server::command_function>	Server::m_commands;
-std::map<std::string, std::size_t>				Server::m_command_stats;
+Server::command_function						Server::m_command_functions[COMMAND_COUNT];
+int												Server::m_command_flags[COMMAND_COUNT];
+CommandStats									Server::m_command_stats[COMMAND_COUNT];
+CommandId										Server::m_current_command = COMMAND_UNKNOWN;
 
 const std::size_t	Server::m_awaylen = 50;
 const std::size_t	Server::m_chan_name_len = 50;
 const std::size_t	Server::m_kicklen = 120;
-const std::size_t	Server::m_max_lists_entries = 20;
 const std::size_t	Server::m_userlen = 20;
 const std::size_t	Server::m_topiclen = 80;
 
-std::map<std::string, Server::command_function>	Server::m_connection_commands;
-
-OldUserInfo::OldUserInfo(std::time_t time, const User &user)
-	: m_last_time_seen(time), m_nickname(user.nickname()),
-	m_username(user.username()), m_realname(user.realname()), m_host(user.ip())
-{
-}
-
-bool OldUserInfo::operator==(const User &user) const
-{
-	return to_upper(m_nickname) == user.nickname_upper() && m_username == user.username() && m_realname == user.realname() && m_host == user.ip();
-}
-
-bool OldUserInfo::operator==(const OldUserInfo &user) const
-{
-	return to_upper(m_nickname) == to_upper(user.nickname()) && m_username == user.username() && m_realname == user.realname() && m_host == user.host();
-}
-
 void Server::signal_handler(int signal)
 {
-	(void) signal;
+	if (signal == SIGUSR1) {
+		m_is_tick_profile_requested = 1;
+		return ;
+	}
 	m_is_running = false;
 }
 
 bool Server::initialize(uint16_t port)
 {
-	if (!initialize_operator_credential()) {
-		CORE_ERROR("Couldn't initialize operator credential");
+	if (!initialize_config()) {
+		CORE_ERROR("Couldn't load the server configuration");
 		return false;
 	}
 
+	// From now on, the messages are written by the log thread
+	if (!Log::start(m_log_file))
+		return false;
+	if (!m_journal_file.empty() && !Journal::start(m_journal_file, m_journal_file_size, m_journal_file_count))
+		return false;
+
 	m_server_socket = socket(AF_INET, SOCK_STREAM, 0);
 	if (m_server_socket < 0) {
 		CORE_ERROR("socket: %s", strerror(errno));
@@ -100,17 +113,23 @@ bool Server::initialize(uint16_t port)
 		return false;
 	}
 
-	if (listen(m_server_socket, m_server_backlog)) {
+	if (listen(m_server_socket, m_listen_backlog)) {
 		CORE_ERROR("listen: %s", strerror(errno));
 		return false;
 	}
 
-	// setup server pollfd
-	pollfd m_server_pollfd = {};
-	m_server_pollfd.fd = m_server_socket;
-	m_server_pollfd.events = POLLIN;
-	m_server_pollfd.revents = 0;
-	m_pollfds.push_back(m_server_pollfd);
+	// The listen queue is drained until accept() would block
+	if (fcntl(m_server_socket, F_SETFL, O_NONBLOCK) < 0) {
+		CORE_ERROR("fcntl: %s", strerror(errno));
+		return false;
+	}
+
+	// setup the event backend, the server socket is the only entry without a User attached
+	if (!m_event_backend.initialize() || !m_event_backend.add(m_server_socket, EventBackend::EVENT_READ, NULL)) {
+		CORE_ERROR("Couldn't initialize the %s event backend", EventBackend::name());
+		return false;
+	}
+	CORE_INFO("Using the %s event backend", EventBackend::name());
 
 	initialize_command_functions();
 	load_old_user_list_from_file();
@@ -125,224 +144,392 @@ bool Server::initialize(uint16_t port)
 void Server::initialize_command_functions()
 {
 	// register commands
-	m_connection_commands.insert(std::make_pair("CAP", cap));
-	m_connection_commands.insert(std::make_pair("NICK", nick));
-	m_connection_commands.insert(std::make_pair("PASS", pass));
-	m_connection_commands.insert(std::make_pair("USER", user));
+	register_command(COMMAND_CAP, cap, COMMAND_BEFORE_REGISTRATION);
+	register_command(COMMAND_NICK, nick, COMMAND_BEFORE_REGISTRATION);
+	register_command(COMMAND_PASS, pass, COMMAND_BEFORE_REGISTRATION);
+	register_command(COMMAND_USER, user, COMMAND_BEFORE_REGISTRATION);
 
 	// connection commands
-	m_commands.insert(std::make_pair("OPER", oper));
-	m_commands.insert(std::make_pair("PING", ping));
-	m_commands.insert(std::make_pair("PONG", pong));
-	m_commands.insert(std::make_pair("QUIT", quit));
-	m_commands.insert(std::make_pair("NICK", nick));
+	register_command(COMMAND_OPER, oper, COMMAND_AFTER_REGISTRATION);
+	register_command(COMMAND_PING, ping, COMMAND_AFTER_REGISTRATION);
+	register_command(COMMAND_PONG, pong, COMMAND_AFTER_REGISTRATION);
+	register_command(COMMAND_QUIT, quit, COMMAND_AFTER_REGISTRATION);
+	register_command(COMMAND_NICK, nick, COMMAND_AFTER_REGISTRATION);
 
 	// channel commands
-	m_commands.insert(std::make_pair("JOIN", join));
-	m_commands.insert(std::make_pair("PART", part));
-	m_commands.insert(std::make_pair("TOPIC", topic));
-	m_commands.insert(std::make_pair("NAMES", names));
-	m_commands.insert(std::make_pair("LIST", list));
-	m_commands.insert(std::make_pair("KICK", kick));
-	m_commands.insert(std::make_pair("MODE", mode));
-	m_commands.insert(std::make_pair("PRIVMSG", privmsg));
-	m_commands.insert(std::make_pair("NOTICE", notice));
-	m_commands.insert(std::make_pair("INVITE", invite));
+	register_command(COMMAND_JOIN, join, COMMAND_AFTER_REGISTRATION);
+	register_command(COMMAND_PART, part, COMMAND_AFTER_REGISTRATION);
+	register_command(COMMAND_TOPIC, topic, COMMAND_AFTER_REGISTRATION);
+	register_command(COMMAND_NAMES, names, COMMAND_AFTER_REGISTRATION);
+	register_command(COMMAND_LIST, list, COMMAND_AFTER_REGISTRATION);
+	register_command(COMMAND_KICK, kick, COMMAND_AFTER_REGISTRATION);
+	register_command(COMMAND_MODE, mode, COMMAND_AFTER_REGISTRATION);
+	register_command(COMMAND_PRIVMSG, privmsg, COMMAND_AFTER_REGISTRATION);
+	register_command(COMMAND_NOTICE, notice, COMMAND_AFTER_REGISTRATION);
+	register_command(COMMAND_INVITE, invite, COMMAND_AFTER_REGISTRATION);
 
 	// server commands
-	m_commands.insert(std::make_pair("ADMIN", admin));
-	m_commands.insert(std::make_pair("MODE", mode));
-	m_commands.insert(std::make_pair("MOTD", motd));
-	m_commands.insert(std::make_pair("VERSION", version));
-	m_commands.insert(std::make_pair("TIME", time_cmd));
-	m_commands.insert(std::make_pair("INFO", info_cmd));
-	m_commands.insert(std::make_pair("LUSERS", lusers));
-	m_commands.insert(std::make_pair("STATS", stats));
-	m_commands.insert(std::make_pair("KILL", kill));
+	register_command(COMMAND_ADMIN, admin, COMMAND_AFTER_REGISTRATION);
+	register_command(COMMAND_MOTD, motd, COMMAND_AFTER_REGISTRATION);
+	register_command(COMMAND_VERSION, version, COMMAND_AFTER_REGISTRATION);
+	register_command(COMMAND_TIME, time_cmd, COMMAND_AFTER_REGISTRATION);
+	register_command(COMMAND_INFO, info_cmd, COMMAND_AFTER_REGISTRATION);
+	register_command(COMMAND_LUSERS, lusers, COMMAND_AFTER_REGISTRATION);
+	register_command(COMMAND_STATS, stats, COMMAND_AFTER_REGISTRATION);
+	register_command(COMMAND_KILL, kill, COMMAND_AFTER_REGISTRATION);
 
 	// User queries
-	m_commands.insert(std::make_pair("WHO", who));
-	m_commands.insert(std::make_pair("WHOWAS", whowas));
-	m_commands.insert(std::make_pair("WHOIS", whois));
+	register_command(COMMAND_WHO, who, COMMAND_AFTER_REGISTRATION);
+	register_command(COMMAND_WHOWAS, whowas, COMMAND_AFTER_REGISTRATION);
+	register_command(COMMAND_WHOIS, whois, COMMAND_AFTER_REGISTRATION);
 
 	// Optional commands
-	m_commands.insert(std::make_pair("AWAY", away));
+	register_command(COMMAND_AWAY, away, COMMAND_AFTER_REGISTRATION);
+}
+
+void Server::register_command(CommandId id, command_function function, int flags)
+{
+	m_command_functions[id] = function;
+	m_command_flags[id] |= flags;
 }
 
 bool Server::update()
 {
+	m_tick_profiler.start_tick();
 	poll_events();
+	m_tick_profiler.end_phase(TickProfiler::PHASE_POLL);
 	accept_new_connections();
+	m_tick_profiler.end_phase(TickProfiler::PHASE_ACCEPT);
 	handle_events();
+	m_tick_profiler.end_phase(TickProfiler::PHASE_EVENTS);
 	handle_messages();
+	m_tick_profiler.end_phase(TickProfiler::PHASE_MESSAGES);
+	flush_pending_writes();
+	m_tick_profiler.end_phase(TickProfiler::PHASE_FLUSH);
 	check_for_closed_connexions();
+	m_tick_profiler.end_phase(TickProfiler::PHASE_CLOSED_CONNEXIONS);
 	check_for_empty_channels();
+	m_tick_profiler.end_phase(TickProfiler::PHASE_EMPTY_CHANNELS);
+	m_tick_profiler.end_tick(m_event_backend.ready_events().size());
+
+	if (m_is_tick_profile_requested) {
+		m_is_tick_profile_requested = 0;
+		log_tick_profile();
+	}
 	return true;
 }
 
+void Server::log_tick_profile()
+{
+	std::vector<std::string> lines;
+	m_tick_profiler.summarize(lines);
+	for (std::vector<std::string>::iterator line_it = lines.begin(); line_it != lines.end(); line_it++)
+		CORE_INFO("Tick profile: %s", line_it->c_str());
+}
+
 void Server::accept_new_connections()
 {
-	if ((m_pollfds[0].revents & POLLIN) == 0)
+	if (!m_is_server_socket_readable)
 		return ;
 
-	struct sockaddr_in client = {};
+	// Accept at most m_accept_batch_size clients per tick, the rest of the
+	//  listen queue is reported again by the next poll
+	for (std::size_t accepted = 0; accepted < m_accept_batch_size; accepted++) {
+		struct sockaddr_in client = {};
+
+		int new_client_socket_fd = accept_client(client);
+		if (new_client_socket_fd < 0) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+				CORE_ERROR("accept: %s", strerror(errno));
+			return ;
+		}
+		CORE_INFO("Incomming connexion from : %s:%u", inet_ntoa(client.sin_addr), ntohs(client.sin_port));
+
+		User& new_user = create_new_user(new_client_socket_fd, inet_ntoa(client.sin_addr), ntohs(client.sin_port));
+		if (!m_event_backend.add(new_client_socket_fd, EventBackend::EVENT_READ, &new_user)) {
+			close(new_client_socket_fd);
+			remove_user(new_user);
+			continue ;
+		}
+
+		m_unknown_connections++;
+	}
+}
+
+int Server::accept_client(sockaddr_in& client)
+{
 	socklen_t len = sizeof(client);
 
+#ifdef PLATFORM_LINUX
+	// accept4 sets the flags on the new socket without extra syscalls
+	return accept4(m_server_socket, reinterpret_cast<sockaddr *>(&client), &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
 	int new_client_socket_fd = accept(m_server_socket, reinterpret_cast<sockaddr *>(&client), &len);
-	if (new_client_socket_fd <= 0)
-		CORE_ERROR("accept: %s", strerror(errno));
-	CORE_INFO("Incomming connexion from : %s:%u", inet_ntoa(client.sin_addr), ntohs(client.sin_port));
+	if (new_client_socket_fd < 0)
+		return -1;
 
-	if (fcntl(new_client_socket_fd, F_SETFL, O_NONBLOCK) < 0) {
+	if (fcntl(new_client_socket_fd, F_SETFL, O_NONBLOCK) < 0 || fcntl(new_client_socket_fd, F_SETFD, FD_CLOEXEC) < 0) {
 		CORE_ERROR("fcntl: %s", strerror(errno));
 		close(new_client_socket_fd);
-		return ;
+		errno = EAGAIN;
+		return -1;
 	}
-
-	m_unknown_connections++;
-
-	pollfd pollfds = {};
-	pollfds.fd = new_client_socket_fd;
-	pollfds.events = POLLIN | POLLOUT;
-	pollfds.revents = 0;
-
-	m_pollfds.push_back(pollfds);
-	create_new_user(new_client_socket_fd, inet_ntoa(client.sin_addr), ntohs(client.sin_port));
+	return new_client_socket_fd;
+#endif
 }
 
 void Server::poll_events()
 {
-	int poll_count = poll(m_pollfds.data(), (nfds_t)m_pollfds.size(), m_timeout);
-	if (poll_count < 0 && errno != EINTR) {
-		CORE_ERROR("poll: %s", strerror(errno));
-	}
+	// Don't sleep if some users still have commands waiting in their read buffer
+	m_event_backend.wait(m_users_with_commands.empty() ? m_timeout : 0);
 
-	size_t i = 1; // skip server socket
-	for (UserIterator user_it = m_users.begin(); user_it != m_users.end(); user_it++, i++) {
-		User& user = get_user_reference(user_it);
-		user.set_is_readable(m_pollfds[i].revents & POLLIN);
-		user.set_is_writable(m_pollfds[i].revents & POLLOUT);
+	m_is_server_socket_readable = false;
+	const EventBackend::EventVector& events = m_event_backend.ready_events();
+	for (EventBackend::ConstEventIterator event_it = events.begin(); event_it != events.end(); event_it++) {
+		if (event_it->data == NULL)
+			m_is_server_socket_readable = true;
 	}
 }
 
 void Server::handle_events()
 {
-	for (UserIterator user_it = m_users.begin(); user_it != m_users.end(); user_it++) {
-		User& user = get_user_reference(user_it);
-		if (user.is_readable()) {
+	const EventBackend::EventVector& events = m_event_backend.ready_events();
+	for (EventBackend::ConstEventIterator event_it = events.begin(); event_it != events.end(); event_it++) {
+		// Skip the server socket
+		if (event_it->data == NULL)
+			continue ;
+
+		User& user = get_user_reference(static_cast<User*>(event_it->data));
+		if (event_it->flags & EventBackend::EVENT_READ) {
 			if (!user.receive_message())
 				user.disconnect();
+			else
+				queue_for_commands(user);
 		}
-		if (user.is_writable()) {
-			if (!user.write_buffer().empty() && !user.send_message())
+		if (event_it->flags & EventBackend::EVENT_WRITE) {
+			if (!user.send_message())
 				user.disconnect();
+			update_write_interest(user);
 		}
 	}
 }
 
 void Server::handle_messages()
 {
-	for (UserIterator user_it = m_users.begin(); user_it != m_users.end(); user_it++) {
+	// Each user runs at most m_commands_per_tick commands, the ones left in
+	//  its read buffer are run during the next ticks
+	m_users_running_commands.swap(m_users_with_commands);
+	for (UserIterator user_it = m_users_running_commands.begin(); user_it != m_users_running_commands.end(); user_it++) {
 		User& user = get_user_reference(user_it);
+		user.set_is_queued_for_commands(false);
 
-		if (!user.has_pending_command() || user.is_disconnected())
-			continue ;
+		for (std::size_t i = 0; i < m_commands_per_tick; i++) {
+			if (user.is_disconnected() || !user.has_pending_command())
+				break ;
+
+			// The line is parsed in place, the owned copy is only made for valid commands
+			StringView	command_line;
+			user.peek_next_command(command_line);
+			CommandView	command_view(command_line);
+			if (!command_view.is_valid()) {
+				Journal::record_received(user.connection_id(), COMMAND_UNKNOWN, command_line.data(), command_line.size());
+				user.pop_next_command();
+				continue ;
+			}
+
+			CommandId	command_id = CommandTable::find(command_view.command());
+			Journal::record_received(user.connection_id(), command_id, command_line.data(), command_line.size());
+			Command		command(command_view);
+			std::size_t	line_length = command_line.size();
+			user.pop_next_command();
+
+			command.print();
+			m_current_command = command_id;
+			execute_command(user, command_id, command, line_length);
+			m_current_command = COMMAND_UNKNOWN;
+			m_tick_profiler.count_command();
+		}
+
+		queue_for_commands(user);
+	}
+	m_users_running_commands.clear();
+}
 
-		std::string	command_str = user.get_next_command_str();
-		Command		command(command_str);
+void Server::queue_for_commands(User& user)
+{
+	if (user.is_queued_for_commands() || user.is_disconnected() || !user.has_pending_command())
+		return ;
+	user.set_is_queued_for_commands(true);
+	m_users_with_commands.push_back(&user);
+}
 
-		command.print();
-		if (command.is_valid())
-			execute_command(user, command);
+void Server::flush_pending_writes()
+{
+	// Write directly to the sockets that got replies during this tick,
+	//  only what the kernel couldn't take waits for a writable event
+	for (UserIterator user_it = m_users_to_flush.begin(); user_it != m_users_to_flush.end(); user_it++) {
+		User& user = get_user_reference(user_it);
+		user.set_is_queued_for_flush(false);
+		if (!user.send_message())
+			user.disconnect();
+		else if (user.write_buffer().size() > max_sendq(user))
+			disconnect_slow_consumer(user);
+		update_write_interest(user);
 	}
+	m_users_to_flush.clear();
+}
+
+void Server::update_write_interest(User& user)
+{
+	if (user.is_disconnected())
+		return ;
+
+	bool wants_write_events = !user.write_buffer().empty();
+	if (wants_write_events == user.wants_write_events())
+		return ;
+
+	int interest = EventBackend::EVENT_READ;
+	if (wants_write_events)
+		interest |= EventBackend::EVENT_WRITE;
+	if (m_event_backend.modify(user.fd(), interest, &user))
+		user.set_wants_write_events(wants_write_events);
 }
 
-void Server::execute_command(User &user, const Command &cmd)
+void Server::execute_command(User &user, CommandId id, const Command &cmd, std::size_t line_length)
 {
-	CommandIterator command_it;
-	std::string command_name = to_upper(cmd.get_command());
+	if (id == COMMAND_UNKNOWN) {
+		reply(user, ERR_UNKNOWNCOMMAND(user, to_upper(cmd.get_command())));
+		return ;
+	}
+
+	CommandStats& stats = m_command_stats[id];
+	stats.bytes_in += line_length;
 
 	if (!user.is_registered()) {
-		command_it = m_connection_commands.find(command_name);
-		if (command_it != m_connection_commands.end()) {
-			if (user.need_password() && to_upper(cmd.get_command()) == "NICK") {
-				if (!user.check_password()) {
-					Server::reply(user, ERR_PASSWDMISMATCH(user));
-					user.disconnect();
-					return;
-				}
+		if (!(m_command_flags[id] & COMMAND_BEFORE_REGISTRATION)) {
+			reply(user, ERR_NOTREGISTERED(user));
+			return ;
+		}
+		if (id == COMMAND_NICK && user.need_password()) {
+			if (!user.check_password()) {
+				Server::reply(user, ERR_PASSWDMISMATCH(user));
+				user.disconnect();
+				return;
 			}
-			m_command_stats[command_name]++;
-			command_it->second(user, cmd);
 		}
-		else if (m_commands.find(command_name) != m_commands.end())
-			reply(user, ERR_NOTREGISTERED(user));
-		else
-			reply(user, ERR_UNKNOWNCOMMAND(user, command_name));
+	} else if (!(m_command_flags[id] & COMMAND_AFTER_REGISTRATION)) {
+		reply(user, ERR_ALREADYREGISTERED(user));
 		return ;
 	}
 
-	command_it = m_commands.find(command_name);
-	if (command_it != m_commands.end()) {
-		m_command_stats[command_name]++;
-		command_it->second(user, cmd);
-	} else if (m_connection_commands.find(command_name) != m_connection_commands.end())
-		reply(user, ERR_ALREADYREGISTERED(user));
-	else
-		reply(user, ERR_UNKNOWNCOMMAND(user, command_name));
+	uint64_t start = monotonic_nanoseconds();
+	m_command_functions[id](user, cmd);
+	stats.latency.record(monotonic_nanoseconds() - start);
+	stats.count++;
 }
 
 void Server::reply(User& user, const std::string &msg)
 {
 	CORE_TRACE("REPLYING TO %s:%d [%s]", user.ip().c_str(), user.port(), msg.c_str());
-	user.queue_command_for_sending(msg + "\r\n");
+	reply(user, SharedMessage(msg));
+}
+
+void Server::reply(User& user, const SharedMessage& msg)
+{
+	if (user.is_disconnected())
+		return ;
+
+	Journal::record_sent(user.connection_id(), m_current_command, msg.data(), msg.size());
+	if (m_current_command != COMMAND_UNKNOWN)
+		m_command_stats[m_current_command].bytes_out += msg.size();
+	// The SendQ is only checked once the socket took what it could, in
+	//  flush_pending_writes, so that a large reply doesn't count against it
+	user.queue_command_for_sending(msg);
+	if (!user.is_queued_for_flush()) {
+		user.set_is_queued_for_flush(true);
+		m_users_to_flush.push_back(&user);
+	}
+}
+
+void Server::disconnect_slow_consumer(User& user)
+{
+	CORE_WARN("User %s exceeded its SendQ of %llu bytes", user.debug_name(), static_cast<unsigned long long>(max_sendq(user)));
+	m_sendq_exceeded_count++;
+
+	// Whatever is still queued won't be read, just try to tell the user why it's dropped
+	user.clear_write_buffer();
+	SharedMessage error_msg("ERROR :Closing Link: " + user.ip() + " (Max SendQ exceeded)");
+	Journal::record_sent(user.connection_id(), m_current_command, error_msg.data(), error_msg.size());
+	user.queue_command_for_sending(error_msg);
+	// Called while flushing, a single attempt is all the user gets
+	user.send_message();
+	user.disconnect();
 }
 
 void Server::broadcast(const std::string &msg)
 {
 	CORE_TRACE("BROADCASTING [%s]", msg.c_str());
+	SharedMessage shared_msg(msg);
 	for (UserIterator user_it = m_users.begin(); user_it != m_users.end(); user_it++)
-		reply(get_user_reference(user_it), msg);
+		reply(get_user_reference(user_it), shared_msg);
 }
 
 void Server::broadcast(User& user_to_avoid, const std::string &msg)
 {
 	CORE_TRACE("BROADCASTING [%s]", msg.c_str());
+	SharedMessage shared_msg(msg);
 	for (UserIterator user_it = m_users.begin(); user_it != m_users.end(); user_it++) {
 		User& user = get_user_reference(user_it);
 		if (user != user_to_avoid)
-			reply(user, msg);
+			reply(user, shared_msg);
 	}
 }
 
 void Server::broadcast_to_channel(Channel& channel, const std::string& msg)
 {
 	CORE_TRACE("BROADCASTING [%s] TO %s", msg.c_str(), channel.name().c_str());
+	SharedMessage shared_msg(msg);
 	for (Channel::UserIterator user_it = channel.users().begin(); user_it != channel.users().end(); user_it++)
-		reply(get_user_reference(user_it), msg);
+		reply(get_user_reference(user_it), shared_msg);
 }
 
 void Server::broadcast_to_channel(User& user_to_avoid, Channel& channel, const std::string& msg)
 {
 	CORE_TRACE("BROADCASTING [%s] TO %s from %s", msg.c_str(), channel.name().c_str(), user_to_avoid.nickname().c_str());
+	SharedMessage shared_msg(msg);
 	for (Channel::UserIterator user_it = channel.users().begin(); user_it != channel.users().end(); user_it++) {
 		User& user = get_user_reference(user_it);
 		if (user != user_to_avoid)
-			reply(user, msg);
+			reply(user, shared_msg);
 	}
 }
 
 void Server::check_for_closed_connexions()
 {
-	for (size_t i = 0; i < m_users.size(); i++) {
-		User& user = get_user_reference(m_users[i]);
-		if (user.is_disconnected()) {
-			CORE_INFO("%s disconnected", user.nickname().c_str());
-			m_pollfds.erase(m_pollfds.begin() + static_cast<long>(i + 1));
-			close(user.fd());
-			remove_user(user);
-		}
+	if (m_users_to_remove.empty())
+		return ;
+
+	// Users that got disconnected while having commands left mustn't stay queued
+	UserIterator last_queued = m_users_with_commands.begin();
+	for (UserIterator user_it = m_users_with_commands.begin(); user_it != m_users_with_commands.end(); user_it++) {
+		if (!get_user_reference(user_it).is_disconnected())
+			*last_queued++ = *user_it;
+	}
+	m_users_with_commands.erase(last_queued, m_users_with_commands.end());
+
+	for (UserIterator user_it = m_users_to_remove.begin(); user_it != m_users_to_remove.end(); user_it++) {
+		User& user = get_user_reference(user_it);
+		CORE_INFO("%s disconnected", user.nickname().c_str());
+		m_event_backend.remove(user.fd());
+		close(user.fd());
+		remove_user(user);
 	}
+	m_users_to_remove.clear();
+}
+
+void Server::schedule_user_removal(User& user)
+{
+	m_users_to_remove.push_back(&user);
 }
 
 void Server::check_for_empty_channels()
@@ -366,11 +553,14 @@ void Server::shutdown()
 		delete &user;
 	}
 	close(m_server_socket);
+	m_event_backend.shutdown();
 
 	for (ChannelIterator channel_it = m_channels.begin(); channel_it != m_channels.end(); channel_it++)
 		delete channel_it->second;
 
+	Journal::stop();
 	CORE_INFO("Server shutdown");
+	Log::stop();
 }
 
 bool Server::is_nickname_taken(const std::string &nickname)
@@ -414,7 +604,7 @@ void Server::try_reply_list_channel_members_to_user(User &user, const std::strin
 void Server::reply_list_channel_members_to_user(User &user, const Channel& channel)
 {
 	for (Channel::ConstUserIterator channel_user_it = channel.users().begin(); channel_user_it != channel.users().end(); channel_user_it++) {
-		reply(user, RPL_NAMREPLY(user, channel, (*channel_user_it->first), channel_user_it->second));
+		reply(user, RPL_NAMREPLY(user, channel, get_user_reference(channel_user_it), get_user_perms_reference(channel_user_it)));
 	}
 	reply(user, RPL_ENDOFNAMES(user, channel.name()));
 }
@@ -426,24 +616,15 @@ bool Server::user_exists(const Server::UserIterator &user)
 
 bool Server::user_exists(const std::string &user_nickname)
 {
-	std::string user_nickname_to_upper = to_upper(user_nickname);
-	for (UserIterator user_it = m_users.begin(); user_it != m_users.end(); user_it++) {
-		User& user = get_user_reference(user_it);
-		if (user.nickname_upper() == user_nickname_to_upper)
-			return true;
-	}
-	return false;
+	return m_nicknames.find(user_nickname) != NULL;
 }
 
 Server::UserIterator Server::find_user(const std::string &user_nickname)
 {
-	std::string user_nickname_to_upper = to_upper(user_nickname);
-	for (UserIterator user_it = m_users.begin(); user_it != m_users.end(); user_it++) {
-		User& user = get_user_reference(user_it);
-		if (user.nickname_upper() == user_nickname_to_upper)
-			return user_it;
-	}
-	return m_users.end();
+	User *user = m_nicknames.find(user_nickname);
+	if (!user)
+		return m_users.end();
+	return m_users.iterator_to(*user);
 }
 
 bool Server::channel_exists(const Server::ChannelIterator &channel)
@@ -453,7 +634,7 @@ bool Server::channel_exists(const Server::ChannelIterator &channel)
 
 bool Server::channel_exists(const std::string &channel_name)
 {
-	ChannelIterator channel_it = m_channels.find(to_upper(channel_name));
+	ChannelIterator channel_it = m_channels.find(channel_name);
 	if (channel_exists(channel_it))
 		return true;
 	return false;
@@ -461,7 +642,7 @@ bool Server::channel_exists(const std::string &channel_name)
 
 Server::ChannelIterator Server::find_channel(const std::string &channel_name)
 {
-	return m_channels.find(to_upper(channel_name));
+	return m_channels.find(channel_name);
 }
 
 void Server::try_reply_part_user_from_channel(User &user, const std::string &channel_name, const std::string& reason)
@@ -491,11 +672,12 @@ void Server::reply_part_user_from_channel(User &user, Channel &channel, const st
 	if (!reason.empty())
 		separator += ' ';
 
-	reply(user, USER_SOURCE("PART", user) + " " + channel.name() + separator + reason);
+	SharedMessage part_msg(USER_SOURCE("PART", user) + " " + channel.name() + separator + reason);
+	reply(user, part_msg);
 
 	// Notify other channel users
 	for (Channel::UserIterator channel_user_it = channel.users().begin(); channel_user_it != channel.users().end(); channel_user_it++)
-		reply(get_user_reference(channel_user_it), USER_SOURCE("PART", user) + " " + channel.name() + separator + reason);
+		reply(get_user_reference(channel_user_it), part_msg);
 }
 
 void Server::reply_part_user_from_channels(User &user, const std::string& reason)
@@ -507,14 +689,13 @@ void Server::reply_part_user_from_channels(User &user, const std::string& reason
 User& Server::create_new_user(int fd, const std::string &ip, uint16_t port)
 {
 	User *new_user = new User(fd, ip, port);
-	m_users.push_back(new_user);
+	m_users.insert(*new_user);
 	return *new_user;
 }
 
 void Server::remove_user(User &user)
 {
-	UserIterator user_it = std::find(m_users.begin(), m_users.end(), &user);
-	if (user_it == m_users.end()) {
+	if (!m_users.contains(user)) {
 		CORE_WARN("Trying to remove a user that doesn't belong to the server's users list");
 		return ;
 	}
@@ -526,14 +707,15 @@ void Server::remove_user(User &user)
 
 	add_to_old_users_list(user);
 
-	m_users.erase(user_it);
+	m_nicknames.remove(user);
+	m_users.remove(user);
 	delete &user;
 }
 
 Channel& Server::create_new_channel(User &first_user, const std::string &channel_name)
 {
 	Channel *new_channel = new Channel(first_user, channel_name);
-	m_channels[to_upper(channel_name)] = new_channel;
+	m_channels[channel_name] = new_channel;
 	return *new_channel;
 }
 
@@ -553,7 +735,7 @@ std::string Server::supported_tokens(User& user)
 	std::string tokens;
 
 	tokens += "AWAYLEN=" + to_string(m_awaylen) + " ";
-	tokens += "CASEMAPPING=ascii ";
+	tokens += "CASEMAPPING=" + std::string(Casemapping::name()) + " ";
 	tokens += "CHANLIMIT=&#: "; // Unlimited if no value.
 	tokens += "CHANMODES=beI,,kl,mnst ";
 	tokens += "CHANNELLEN=" + to_string(m_chan_name_len) + " ";
@@ -583,7 +765,7 @@ std::string Server::supported_tokens(User& user)
 
 void Server::reply_channel_ban_list_to_user(User &user, const Channel &channel)
 {
-	CORE_TRACE("Channel ban list size %d", channel.ban_list().size());
+	CORE_TRACE("Channel ban list size %llu", static_cast<unsigned long long>(channel.ban_list().size()));
 	for (size_t i = 0; i < channel.ban_list().size(); i++) {
 		Server::reply(user, RPL_BANLIST(user, channel, channel.ban_list()[i]));
 	}
@@ -612,12 +794,8 @@ void Server::reply_list_of_channel_invite_to_user(User &user)
 	for (; channel_it != m_channels.end(); channel_it++)
 	{
 		const Channel& channel = get_channel_reference(channel_it);
-		for (size_t i = 0; i < channel.invite_list().size(); ++i) {
-			if (channel.invite_list().at(i) == user.nickname()) {
-				Server::reply(user, RPL_INVITELIST(user, channel.name()));
-				break ;
-			}
-		}
+		if (channel.is_user_in_invite_list(user.nickname()))
+			Server::reply(user, RPL_INVITELIST(user, channel.name()));
 	}
 	Server::reply(user, RPL_ENDOFINVITELIST(user, channel_it->first));
 }
@@ -627,43 +805,18 @@ void Server::add_to_old_users_list(User &user)
 	if (!user.is_registered())
 		return ;
 
-	// If the user disconnecting was already known by the server,
-	//  delete its old entry (i.e. just update it)
-	OldUserIterator entry = std::find(m_old_users.begin(), m_old_users.end(), user);
-	if (entry != m_old_users.end())
-		m_old_users.erase(entry);
-
-	m_old_users.push_back(OldUserInfo(time(NULL), user));
-	if (m_old_users.size() > 5000)
-		m_old_users.erase(m_old_users.begin());
-}
-
-Server::OldUserIterator Server::find_old_user(const std::string &user_nickname, OldUserIterator start)
-{
-	if (m_old_users.empty())
-		return m_old_users.end();
-
-	if (start == m_old_users.begin())
-		return m_old_users.end();
-
-	std::string user_nickname_to_upper = to_upper(user_nickname);
-
-	for (OldUserIterator user_it = start - 1; user_it != m_old_users.begin(); user_it--) {
-		if (to_upper(user_it->nickname()) == user_nickname_to_upper)
-			return user_it;
-	}
-
-	if (to_upper(m_old_users.begin()->nickname()) == user_nickname_to_upper)
-		return m_old_users.begin();
-
-	return m_old_users.end();
+	// If the user disconnecting was already known by the server, its old entry is replaced
+	m_old_users.add(OldUserInfo(time(NULL), user));
 }
 
 void Server::store_user_list_to_file()
 {
 	std::ofstream file("config/user_list.csv", std::ios::trunc);
 
-	for (OldUserIterator user_it = m_old_users.begin(); file.good() && user_it != m_old_users.end(); user_it++) {
+	const OldUserList::EntryDeque& old_users = m_old_users.entries();
+	for (OldUserList::EntryDeque::const_iterator user_it = old_users.begin(); file.good() && user_it != old_users.end(); user_it++) {
+		if (user_it->is_forgotten())
+			continue ;
 		file << user_it->nickname() << ";" << user_it->username() << ";" << user_it->realname();
 		file << ";" << user_it->host() << ";" << user_it->time_last_seen() << std::endl;
 	}
@@ -703,15 +856,15 @@ void Server::load_old_user_list_from_file()
 			!User::is_username_valid(new_user.username()) ||
 			!User::is_host_valid(new_user.host()) ||
 			new_user.time_last_seen() <= 0 ||
-			std::find(m_old_users.begin(), m_old_users.end(), new_user) != m_old_users.end()) {
-			CORE_WARN("Ignoring line %llu in config/user_list.svg: line corrupted", line_number);
+			m_old_users.contains(new_user)) {
+			CORE_WARN("Ignoring line %llu in config/user_list.svg: line corrupted", static_cast<unsigned long long>(line_number));
 		} else
-			m_old_users.push_back(new_user);
+			m_old_users.add(new_user);
 
 		line_number++;
 	}
 
-	CORE_INFO("Loaded %llu users from config file", m_old_users.size());
+	CORE_INFO("Loaded %llu users from config file", static_cast<unsigned long long>(m_old_users.size()));
 }
 
 void Server::register_user(User &user)
@@ -720,9 +873,7 @@ void Server::register_user(User &user)
 
 	// If the user connecting was already known by the server,
 	//  delete its old entry (i.e. just update it)
-	OldUserIterator entry = std::find(m_old_users.begin(), m_old_users.end(), user);
-	if (entry != m_old_users.end())
-		m_old_users.erase(entry);
+	m_old_users.forget(OldUserInfo(time(NULL), user));
 
 	if (users().size() > info().max_users())
 		info().set_max_users(users().size());
@@ -731,10 +882,20 @@ void Server::register_user(User &user)
 void Server::change_user_nickname(User &user, const std::string &new_nickname)
 {
 	add_to_old_users_list(user);
+
+	// The indexes are keyed by the current nickname, so the user must leave them before the change
+	m_nicknames.remove(user);
+	for (User::ChannelIterator channel_it = user.channels().begin(); channel_it != user.channels().end(); channel_it++)
+		get_channel_reference(channel_it).unindex_user(user);
+
 	user.set_nickname(new_nickname);
+
+	m_nicknames.insert(user);
+	for (User::ChannelIterator channel_it = user.channels().begin(); channel_it != user.channels().end(); channel_it++)
+		get_channel_reference(channel_it).index_user(user);
 }
 
-bool Server::initialize_operator_credential()
+bool Server::initialize_config()
 {
 	std::ifstream file("config/IRCd.config", std::ios::in);
 
@@ -757,8 +918,57 @@ bool Server::initialize_operator_credential()
 		} else if (param == "oper_pass") {
 			m_oper_password = splitter.next_param();
 			CORE_DEBUG("m_oper_password: %s", m_oper_password.c_str());
+		} else if (param == "listen_backlog") {
+			std::size_t listen_backlog = static_cast<std::size_t>(m_listen_backlog);
+			if (parse_positive(param, splitter.next_param(), listen_backlog))
+				m_listen_backlog = static_cast<int>(std::min<std::size_t>(listen_backlog, INT_MAX));
+		} else if (param == "accept_batch_size") {
+			parse_positive(param, splitter.next_param(), m_accept_batch_size);
+		} else if (param == "commands_per_tick") {
+			parse_positive(param, splitter.next_param(), m_commands_per_tick);
+		} else if (param == "max_sendq") {
+			parse_positive(param, splitter.next_param(), m_max_sendq);
+		} else if (param == "oper_max_sendq") {
+			parse_positive(param, splitter.next_param(), m_oper_max_sendq);
+		} else if (param == "max_list_entries") {
+			parse_positive(param, splitter.next_param(), m_max_lists_entries);
+		} else if (param == "casemapping") {
+			std::string value = splitter.next_param();
+			if (!Casemapping::set(value))
+				CORE_WARN("Invalid casemapping value [%s], keeping %s", value.c_str(), Casemapping::name());
+			CORE_DEBUG("casemapping: %s", Casemapping::name());
+		} else if (param == "log_level") {
+			std::string value = splitter.next_param();
+			if (!Log::set_level(value))
+				CORE_WARN("Invalid log_level value [%s], keeping %s", value.c_str(), Log::level_name(Log::level()));
+			CORE_DEBUG("log_level: %s", Log::level_name(Log::level()));
+		} else if (param == "log_file") {
+			m_log_file = splitter.next_param();
+			CORE_DEBUG("m_log_file: %s", m_log_file.c_str());
+		} else if (param == "journal_file") {
+			m_journal_file = splitter.next_param();
+			CORE_DEBUG("m_journal_file: %s", m_journal_file.c_str());
+		} else if (param == "journal_file_size") {
+			parse_positive(param, splitter.next_param(), m_journal_file_size);
+		} else if (param == "journal_files") {
+			parse_positive(param, splitter.next_param(), m_journal_file_count);
 		}
 	}
 
 	return true;
 }
+
+/// Logs the new value, or keeps the current one in out when it isn't a positive number
+bool Server::parse_positive(const std::string& param, const std::string& value, std::size_t& out)
+{
+	errno = 0;
+	unsigned long number = is_number(value) ? std::strtoul(value.c_str(), NULL, 10) : 0;
+	if (number == 0 || errno == ERANGE) {
+		CORE_WARN("Invalid %s value [%s], keeping %llu", param.c_str(), value.c_str(), static_cast<unsigned long long>(out));
+		return false;
+	}
+
+	out = static_cast<std::size_t>(number);
+	CORE_DEBUG("%s: %llu", param.c_str(), static_cast<unsigned long long>(out));
+	return true;
+}
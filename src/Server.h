@@ -9,36 +9,32 @@
 #include <netdb.h>
 #include <map>
 #include <string>
+#include <csignal>
 #include "User.h"
 #include "Channel.h"
 #include "Command.h"
 #include "ServerInfo.h"
-
-struct OldUserInfo
+#include "EventBackend.h"
+#include "ConnectionTable.h"
+#include "NicknameIndex.h"
+#include "OldUserList.h"
+#include "Casemapping.h"
+#include "SharedMessage.h"
+#include "CommandTable.h"
+#include "LatencyHistogram.h"
+#include "TickProfiler.h"
+
+/// What each command cost since the server started. The bytes are those of
+///  the command lines and of the replies queued while they ran, rejected
+///  lines included; only the executions are counted and timed.
+struct CommandStats
 {
-	OldUserInfo() : m_last_time_seen(0) {}
-	OldUserInfo(std::time_t time, const User& user);
-
-	bool operator==(const User& user) const;
-	bool operator==(const OldUserInfo& user) const;
-
-	      std::time_t	time_last_seen()	const { return m_last_time_seen; }
-	const std::string&	nickname()			const { return m_nickname; }
-	const std::string&	username()			const { return m_username; }
-	const std::string&	realname()			const { return m_realname; }
-	const std::string&	host()				const { return m_host; }
-
-	void set_time_last_seen(std::time_t value)	{ m_last_time_seen = value; }
-	void set_nickname(const std::string& value)	{ m_nickname = value; }
-	void set_username(const std::string& value)	{ m_username = value; }
-	void set_realname(const std::string& value)	{ m_realname = value; }
-	void set_host(const std::string& value)		{ m_host = value; }
-
-	std::time_t m_last_time_seen;
-	std::string m_nickname;
-	std::string m_username;
-	std::string m_realname;
-	std::string m_host;
+	CommandStats() : count(0), bytes_in(0), bytes_out(0) {}
+
+	std::size_t			count;
+	std::size_t			bytes_in;
+	std::size_t			bytes_out;
+	LatencyHistogram	latency;
 };
 
 class Server
@@ -46,17 +42,12 @@ class Server
 public:
 	/// I/O typedefs
 	typedef int (*command_function)(User&, const Command&);
-	typedef std::map<std::string, command_function>::iterator	CommandIterator;
 
-	typedef std::vector<OldUserInfo>			OldUserVector;
-	typedef OldUserVector::iterator				OldUserIterator;
-	typedef std::vector<User*>					UserVector;
+	typedef ConnectionTable::UserVector			UserVector;
 	typedef UserVector::iterator				UserIterator;
-	typedef std::map<std::string, Channel*>		ChannelMap;
+	typedef std::map<std::string, Channel*, Casemapping::Less>	ChannelMap;
 	typedef ChannelMap::iterator				ChannelIterator;
 	typedef ChannelMap::const_iterator			ConstChannelIterator;
-	typedef std::map<std::string, std::size_t>	CommandStatsMap;
-	typedef CommandStatsMap::const_iterator		CommandStatsIterator;
 
 	/// Server management
 	static bool initialize(uint16_t port);
@@ -75,7 +66,9 @@ public:
 	static void broadcast_to_channel(Channel& channel, const std::string& msg);
 	static void broadcast_to_channel(User& user_to_avoid, Channel& channel, const std::string& msg);
 	static void reply(User& user, const std::string& msg);
+	static void reply(User& user, const SharedMessage& msg);
 	static void reply_welcome_user(User& user);
+	static void disconnect_slow_consumer(User& user);
 	static void try_reply_list_channel_members_to_user(User& user, const std::string& channel_name);
 	static void reply_list_channel_members_to_user(User &user, const Channel& channel);
 	static void reply_channel_list_to_user(User& user);
@@ -92,10 +85,12 @@ public:
 	static void				reply_part_user_from_channels(User& user, const std::string& reason = "");
 	static bool				user_exists(const std::string& user_nickname);
 	static bool				user_exists(const UserIterator& user);
-	static bool				old_user_exists(const OldUserIterator& old_user) { return old_user != m_old_users.end(); };
 	static UserIterator		find_user(const std::string& user_nickname);
-	static OldUserIterator	find_old_user(const std::string& user_nickname, OldUserIterator start = m_old_users.end());
+	/// Newest entry of the nickname in the history, then the older ones, NULL past the last
+	static const OldUserInfo	*find_old_user(const std::string& user_nickname)	{ return m_old_users.find(user_nickname); }
+	static const OldUserInfo	*find_previous_old_user(const OldUserInfo& old_user)	{ return m_old_users.find_previous(old_user); }
 	static bool				is_nickname_taken(const std::string& user_nickname);
+	static void				schedule_user_removal(User& user);
 
 	/// Channel management
 	static Channel&			create_new_channel(User& first_user, const std::string& channel_name);
@@ -113,7 +108,7 @@ public:
 
 	/// User & Channels
 	static       ChannelMap&	channels()				{ return m_channels; }
-	static       UserVector&	users()					{ return m_users; }
+	static       UserVector&	users()					{ return m_users.users(); }
 	static       std::size_t	old_users_count()		{ return m_old_users.size(); }
 
 	/// Setters
@@ -127,21 +122,31 @@ public:
 	static std::size_t	topiclen()						{ return m_topiclen; }
 	static std::size_t	userlen()						{ return m_userlen; }
 	static std::size_t	max_user_lists()				{ return m_max_lists_entries; }
+	static std::size_t	max_sendq(const User& user)		{ return user.is_operator() ? m_oper_max_sendq : m_max_sendq; }
 
 	/// Stats
-	static const CommandStatsMap&	commands_stats()	{ return m_command_stats; }
+	static const CommandStats&		command_stats(CommandId id)	{ return m_command_stats[id]; }
+	static const TickProfiler&		tick_profiler()			{ return m_tick_profiler; }
+	static std::size_t				sendq_exceeded_count()	{ return m_sendq_exceeded_count; }
 
 private:
 	// Member functions
-	static bool		initialize_operator_credential();
+	static bool		initialize_config();
+	static bool		parse_positive(const std::string& param, const std::string& value, std::size_t& out);
 	static void		initialize_command_functions();
+	static void		register_command(CommandId id, command_function function, int flags);
 	static void		accept_new_connections();
+	static int		accept_client(sockaddr_in& client);
 	static void		poll_events();
 	static void		handle_events();
 	static void		handle_messages();
-	static void		execute_command(User& user, const Command& command);
+	static void		queue_for_commands(User& user);
+	static void		flush_pending_writes();
+	static void		update_write_interest(User& user);
+	static void		execute_command(User& user, CommandId id, const Command& command, std::size_t line_length);
 	static void		check_for_closed_connexions();
 	static void		check_for_empty_channels();
+	static void		log_tick_profile();
 
 	/// Users
 	static User&	create_new_user(int fd, const std::string& ip, uint16_t port);
@@ -159,16 +164,35 @@ private:
 	static std::string			m_oper_password;
 	static std::string			m_oper_host;
 
-	static std::vector<pollfd>	m_pollfds;
-	static UserVector			m_users;
-	static OldUserVector		m_old_users;
+	static EventBackend			m_event_backend;
+	static bool					m_is_server_socket_readable;
+	static ConnectionTable		m_users;
+	static NicknameIndex		m_nicknames;
+	static UserVector			m_users_to_flush;
+	static UserVector			m_users_to_remove;
+	static UserVector			m_users_with_commands;
+	static UserVector			m_users_running_commands;
+	static OldUserList			m_old_users;
 	static ChannelMap			m_channels;
 
 	static bool					m_is_running;
 	static std::time_t			m_start_timestamp;
 
-	static const int			m_server_backlog;
 	static const int			m_timeout;
+	static int					m_listen_backlog;
+	static std::size_t			m_accept_batch_size;
+	static std::size_t			m_commands_per_tick;
+	static std::size_t			m_max_sendq;
+	static std::size_t			m_oper_max_sendq;
+	static std::size_t			m_max_lists_entries;
+	static std::string			m_log_file;
+	static std::string			m_journal_file;
+	static std::size_t			m_journal_file_size;
+	static std::size_t			m_journal_file_count;
+	static std::size_t			m_sendq_exceeded_count;
+	static TickProfiler			m_tick_profiler;
+	// Set by SIGUSR1, the profile is logged at the end of the tick
+	static volatile sig_atomic_t	m_is_tick_profile_requested;
 
 	static size_t				m_unknown_connections;
 
@@ -176,15 +200,22 @@ private:
 	static const std::size_t	m_awaylen;
 	static const std::size_t	m_chan_name_len;
 	static const std::size_t	m_kicklen;
-	static const std::size_t	m_max_lists_entries;
 	static const std::size_t	m_userlen;
 	static const std::size_t	m_topiclen;
 
 
-	// Message function prototype
-	static std::map<std::string, command_function>	m_commands;
-	static std::map<std::string, command_function>	m_connection_commands;
-	static CommandStatsMap							m_command_stats;
+	// Commands, indexed by CommandId
+	enum
+	{
+		COMMAND_BEFORE_REGISTRATION = 1,
+		COMMAND_AFTER_REGISTRATION = 2
+	};
+
+	static command_function		m_command_functions[COMMAND_COUNT];
+	static int					m_command_flags[COMMAND_COUNT];
+	static CommandStats			m_command_stats[COMMAND_COUNT];
+	// The replies are attributed to it, COMMAND_UNKNOWN outside of a command
+	static CommandId			m_current_command;
 };
 
 inline Channel&			get_channel_reference(const Server::ChannelIterator& channel_it)		{ return *(channel_it->second); }
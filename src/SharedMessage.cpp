@@ -0,0 +1,46 @@
+//
+// Created by nathan on 4/5/23.
+//
+
+#include "SharedMessage.h"
+
+SharedMessage::SharedMessage() : m_buffer(NULL)
+{
+}
+
+SharedMessage::SharedMessage(const std::string& msg) : m_buffer(new Buffer)
+{
+	m_buffer->ref_count = 1;
+	m_buffer->data.reserve(msg.size() + 2);
+	m_buffer->data.append(msg);
+	m_buffer->data.append("\r\n");
+}
+
+SharedMessage::SharedMessage(const SharedMessage& other) : m_buffer(other.m_buffer)
+{
+	if (m_buffer)
+		m_buffer->ref_count++;
+}
+
+SharedMessage::~SharedMessage()
+{
+	release();
+}
+
+SharedMessage& SharedMessage::operator=(const SharedMessage& other)
+{
+	if (m_buffer == other.m_buffer)
+		return *this;
+	release();
+	m_buffer = other.m_buffer;
+	if (m_buffer)
+		m_buffer->ref_count++;
+	return *this;
+}
+
+void SharedMessage::release()
+{
+	if (m_buffer && --m_buffer->ref_count == 0)
+		delete m_buffer;
+	m_buffer = NULL;
+}
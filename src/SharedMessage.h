@@ -0,0 +1,41 @@
+//
+// Created by nathan on 4/5/23.
+//
+
+#ifndef SHAREDMESSAGE_H
+#define SHAREDMESSAGE_H
+
+#include <string>
+#include <cstddef>
+
+// Immutable reference-counted message, serialized once with its "\r\n".
+//  Copies only bump the reference count, so a message sent to many users
+//  shares a single buffer between all their output queues.
+class SharedMessage
+{
+public:
+	SharedMessage();
+	explicit SharedMessage(const std::string& msg);
+	SharedMessage(const SharedMessage& other);
+	~SharedMessage();
+
+	SharedMessage& operator=(const SharedMessage& other);
+
+	const char*	data()		const	{ return m_buffer ? m_buffer->data.data() : NULL; }
+	std::size_t	size()		const	{ return m_buffer ? m_buffer->data.size() : 0; }
+	bool		empty()		const	{ return size() == 0; }
+	std::size_t	ref_count()	const	{ return m_buffer ? m_buffer->ref_count : 0; }
+
+private:
+	struct Buffer
+	{
+		std::size_t	ref_count;
+		std::string	data;
+	};
+
+	void	release();
+
+	Buffer	*m_buffer;
+};
+
+#endif //SHAREDMESSAGE_H
@@ -0,0 +1,41 @@
+//
+// Created by nathan on 4/6/23.
+//
+
+#ifndef STRINGVIEW_H
+#define STRINGVIEW_H
+
+#include <string>
+#include <cstring>
+#include <cstddef>
+
+// Non-owning view over a sequence of characters, the viewed data must
+//  outlive the view
+class StringView
+{
+public:
+	StringView() : m_data(NULL), m_size(0) {}
+	StringView(const char *data, std::size_t size) : m_data(data), m_size(size) {}
+	explicit StringView(const std::string& str) : m_data(str.data()), m_size(str.size()) {}
+
+	const char*	data()					const	{ return m_data; }
+	std::size_t	size()					const	{ return m_size; }
+	bool		empty()					const	{ return m_size == 0; }
+	char		operator[](std::size_t i)	const	{ return m_data[i]; }
+	const char*	begin()					const	{ return m_data; }
+	const char*	end()					const	{ return m_data + m_size; }
+
+	std::string	str()					const	{ return std::string(m_data, m_size); }
+	StringView	substr(std::size_t pos, std::size_t length) const { return StringView(m_data + pos, length); }
+
+	bool operator==(const StringView& other) const {
+		return m_size == other.m_size && (m_size == 0 || std::memcmp(m_data, other.m_data, m_size) == 0);
+	}
+	bool operator!=(const StringView& other) const { return !(*this == other); }
+
+private:
+	const char	*m_data;
+	std::size_t	m_size;
+};
+
+#endif //STRINGVIEW_H
@@ -0,0 +1,95 @@
+//
+// Created by nathan on 4/10/23.
+//
+
+#include "TickProfiler.h"
+#include "Utils.h"
+
+TickProfiler::TickProfiler() :
+	m_current(0), m_window_start(0), m_tick_start(0), m_phase_start(0), m_poll_duration(0), m_tick_commands(0)
+{
+}
+
+void TickProfiler::start_tick()
+{
+	m_tick_start = monotonic_nanoseconds();
+	m_phase_start = m_tick_start;
+	m_poll_duration = 0;
+	m_tick_commands = 0;
+
+	if (m_window_start == 0)
+		m_window_start = m_tick_start;
+	if (m_tick_start - m_window_start < static_cast<uint64_t>(TICK_PROFILER_WINDOW_SECONDS) * 1000000000)
+		return ;
+
+	// The oldest window is dropped and becomes the current one
+	m_current ^= 1;
+	Window& window = m_windows[m_current];
+	for (std::size_t i = 0; i < PHASE_COUNT; i++)
+		window.phases[i].clear();
+	window.busy.clear();
+	window.ready_events.clear();
+	window.commands.clear();
+	m_window_start = m_tick_start;
+}
+
+void TickProfiler::end_phase(Phase phase)
+{
+	uint64_t now = monotonic_nanoseconds();
+	m_windows[m_current].phases[phase].record(now - m_phase_start);
+	if (phase == PHASE_POLL)
+		m_poll_duration = now - m_phase_start;
+	m_phase_start = now;
+}
+
+void TickProfiler::end_tick(std::size_t ready_events)
+{
+	// The histograms are made for durations, but take these counts just as well
+	Window& window = m_windows[m_current];
+	window.busy.record(m_phase_start - m_tick_start - m_poll_duration);
+	window.ready_events.record(ready_events);
+	window.commands.record(m_tick_commands);
+}
+
+void TickProfiler::summarize(std::vector<std::string>& lines) const
+{
+	Window merged = m_windows[0];
+	const Window& other = m_windows[1];
+	for (std::size_t i = 0; i < PHASE_COUNT; i++)
+		merged.phases[i].merge(other.phases[i]);
+	merged.busy.merge(other.busy);
+	merged.ready_events.merge(other.ready_events);
+	merged.commands.merge(other.commands);
+
+	const LatencyHistogram& busy = merged.busy;
+	lines.push_back(to_string(busy.count()) + " ticks, busy p50 " + format_duration(busy.percentile(0.5)) + " p99 " + format_duration(busy.percentile(0.99))
+		+ " max " + format_duration(busy.max()) + " total " + format_duration(busy.total()));
+
+	for (std::size_t i = 0; i < PHASE_COUNT; i++) {
+		const LatencyHistogram& phase = merged.phases[i];
+		lines.push_back(std::string(phase_name(static_cast<Phase>(i))) + " p50 " + format_duration(phase.percentile(0.5)) + " p99 " + format_duration(phase.percentile(0.99))
+			+ " max " + format_duration(phase.max()) + " total " + format_duration(phase.total()));
+	}
+
+	const LatencyHistogram& ready_events = merged.ready_events;
+	lines.push_back("ready events p50 " + to_string(ready_events.percentile(0.5)) + " p99 " + to_string(ready_events.percentile(0.99))
+		+ " max " + to_string(ready_events.max()));
+	const LatencyHistogram& commands = merged.commands;
+	lines.push_back("commands p50 " + to_string(commands.percentile(0.5)) + " p99 " + to_string(commands.percentile(0.99))
+		+ " max " + to_string(commands.max()) + " total " + to_string(commands.total()));
+}
+
+const char *TickProfiler::phase_name(Phase phase)
+{
+	switch (phase) {
+		case PHASE_POLL:				return "poll_events";
+		case PHASE_ACCEPT:				return "accept_new_connections";
+		case PHASE_EVENTS:				return "handle_events";
+		case PHASE_MESSAGES:			return "handle_messages";
+		case PHASE_FLUSH:				return "flush_pending_writes";
+		case PHASE_CLOSED_CONNEXIONS:	return "check_for_closed_connexions";
+		case PHASE_EMPTY_CHANNELS:		return "check_for_empty_channels";
+		case PHASE_COUNT:
+		default:						return "";
+	}
+}
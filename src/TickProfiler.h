@@ -0,0 +1,68 @@
+//
+// Created by nathan on 4/10/23.
+//
+
+#ifndef TICKPROFILER_H
+#define TICKPROFILER_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+#include "LatencyHistogram.h"
+
+// Ticks are recorded in the current window, and the windows are swapped
+//  every TICK_PROFILER_WINDOW_SECONDS: the summaries cover the last one to two
+//  windows, however many ticks per second the server runs
+#define TICK_PROFILER_WINDOW_SECONDS 60
+
+// Time spent in each phase of Server::update, along with the number of
+//  ready events and of commands run by each tick
+class TickProfiler
+{
+public:
+	enum Phase
+	{
+		PHASE_POLL,
+		PHASE_ACCEPT,
+		PHASE_EVENTS,
+		PHASE_MESSAGES,
+		PHASE_FLUSH,
+		PHASE_CLOSED_CONNEXIONS,
+		PHASE_EMPTY_CHANNELS,
+		PHASE_COUNT
+	};
+
+	TickProfiler();
+
+	void	start_tick();
+	/// The phase lasted from the end of the previous one, or from the start of the tick
+	void	end_phase(Phase phase);
+	void	count_command()		{ m_tick_commands++; }
+	void	end_tick(std::size_t ready_events);
+
+	/// One line per phase and counter, with their p50, p99 and max
+	void	summarize(std::vector<std::string>& lines) const;
+
+private:
+	struct Window
+	{
+		LatencyHistogram	phases[PHASE_COUNT];
+		// The whole tick but the wait in poll_events
+		LatencyHistogram	busy;
+		LatencyHistogram	ready_events;
+		LatencyHistogram	commands;
+	};
+
+	static const char	*phase_name(Phase phase);
+
+	Window			m_windows[2];
+	std::size_t		m_current;
+	uint64_t		m_window_start;
+	uint64_t		m_tick_start;
+	uint64_t		m_phase_start;
+	uint64_t		m_poll_duration;
+	std::size_t		m_tick_commands;
+};
+
+#endif //TICKPROFILER_H
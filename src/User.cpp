@@ -11,22 +11,33 @@
 #include "log.h"
 #include "Numerics.h"
 
+unsigned long User::m_current_sharing_mark = 0;
+uint32_t User::m_next_connection_id = 1;
+
 User::User(int fd, const std::string& ip, uint16_t port) :
-		m_nickname("*"), m_nickname_upper("*"), m_hostname("localhost"),
+		m_nickname("*"), m_hostname("localhost"),
+		m_readbuf(INPUT_BUFFER_INITIAL_SIZE, INPUT_BUFFER_SIZE),
 		m_data_sent_size(0), m_data_received_size(0), m_sent_messages_count(0), m_received_messages_count(0),
-		m_ip(ip), m_port(port), m_fd(fd),
+		m_ip(ip), m_port(port), m_fd(fd), m_connection_id(m_next_connection_id++),
 		m_is_disconnected(false),
-		m_is_readable(false), m_is_writable(false),
-		m_is_registered(false), m_is_negociating_capabilities(false), m_need_password(true),
+		m_is_queued_for_flush(false), m_is_queued_for_commands(false), m_wants_write_events(false),
+		m_is_registered(false), m_is_negociating_capabilities(false), m_need_password(true), m_has_multi_prefix(false), m_sharing_mark(0),
 		m_is_afk(false), m_is_operator(false), m_is_invisible(true), m_can_receive_notice(true),
 		m_signon_timestamp(), m_last_idle_timestamp(), m_idle(0), m_last_ping_timestamp(), m_ping(0), m_connexion_creation_timestamp(time(NULL))
 {
+	update_names();
 }
 
 bool User::receive_message()
 {
-	char buffer[MAX_MESSAGE_LENGTH + 1];
-	ssize_t bytes_read = read(m_fd, buffer, MAX_MESSAGE_LENGTH);
+	// Leave the data in the socket until some commands are consumed
+	if (m_readbuf.full())
+		return true;
+
+	ssize_t bytes_read = m_readbuf.read_from(m_fd);
+
+	if (bytes_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		return true;
 
 	if (bytes_read < 0)
 		CORE_ERROR(std::strerror(errno));
@@ -34,8 +45,6 @@ bool User::receive_message()
 	if (bytes_read <= 0)
 		return false;
 
-	buffer[bytes_read] = 0;
-	m_readbuf.append(buffer);
 	m_data_received_size += static_cast<size_t>(bytes_read);
 
 	return true;
@@ -46,7 +55,10 @@ bool User::send_message()
 	if (m_writebuf.empty())
 		return true;
 
-	ssize_t bytes_write = write(fd(), m_writebuf.c_str(), m_writebuf.size());
+	ssize_t bytes_write = m_writebuf.write_to(m_fd);
+
+	if (bytes_write < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		return true;
 
 	if (bytes_write < 0)
 		CORE_ERROR(std::strerror(errno));
@@ -54,39 +66,39 @@ bool User::send_message()
 	if (bytes_write <= 0)
 		return false;
 
-	m_writebuf.erase(0, static_cast<size_t>(bytes_write));
 	m_data_sent_size += static_cast<size_t>(bytes_write);
 
 	return true;
 }
 
-std::string User::get_next_command_str()
+void User::disconnect()
 {
-	if (!has_pending_command())
-		return "";
-
-	std::size_t command_end = m_readbuf.find_first_of("\n\r");
-	std::size_t crlf_end = command_end + 1;
-	if (m_readbuf[crlf_end] == '\r' || m_readbuf[crlf_end] == '\n')
-		crlf_end++;
-
-	std::string command;
-	if (crlf_end != std::string::npos) {
-		command = m_readbuf.substr(0, crlf_end);
-		m_readbuf.erase(0, command.size());
-	}
+	if (m_is_disconnected)
+		return ;
+	m_is_disconnected = true;
+	Server::schedule_user_removal(*this);
+}
+
+bool User::peek_next_command(StringView& command_line)
+{
+	if (!m_readbuf.peek_line(command_line))
+		return false;
 
-	CORE_TRACE("INCOMING FROM %s[%s]", debug_name(), command.c_str());
-	CORE_DEBUG("User %s command buffer left: %s", debug_name(), m_readbuf.c_str());
+	CORE_TRACE("INCOMING FROM %s[%.*s]", debug_name(), static_cast<int>(command_line.size()), command_line.data());
+	return true;
+}
 
+void User::pop_next_command()
+{
+	m_readbuf.skip_line();
+	CORE_DEBUG("User %s command buffer left: %s", debug_name(), m_readbuf.to_string().c_str());
 	m_received_messages_count++;
-	return command;
 }
 
-std::string User::source() const
+void User::update_names()
 {
-	std::string source = nickname() + "!~" + username() + "@" + ip();
-	return source;
+	m_source = nickname() + "!~" + username() + "@" + ip();
+	m_debug_name = m_nickname + "@" + m_ip + ":" + to_string(m_port);
 }
 
 bool User::check_password()
@@ -147,16 +159,9 @@ void User::recalculate_idle()
 	m_idle = tv.tv_sec - m_last_idle_timestamp.tv_sec;
 }
 
-const char *User::debug_name()
-{
-	static std::string debug_name;
-	debug_name = m_nickname + "@" + m_ip + ":" + to_string(m_port);
-	return debug_name.c_str();
-}
-
 bool User::has_pending_command()
 {
-	return m_readbuf.find_first_of("\r\n") != std::string::npos;
+	return m_readbuf.has_line();
 }
 
 void User::add_channel(Channel &channel)
@@ -168,7 +173,7 @@ void User::remove_channel(const Channel &channel)
 {
 	ChannelIterator it = channels().begin();
 	for (; it < channels().end(); ++it) {
-		if (get_channel_reference(it).name_to_upper() == channel.name_to_upper()) {
+		if (&get_channel_reference(it) == &channel) {
 			channels().erase(it);
 			return;
 		}
@@ -313,19 +318,13 @@ bool User::is_host_valid(const std::string &username)
 
 bool User::has_channel_in_common(const User& other_user) const
 {
+	// Membership checks are O(1), go through the shortest channel list
 	if (channels().size() > other_user.channels().size())
 		return other_user.has_channel_in_common(*this);
 
-	ConstChannelIterator chan_u1 = channels().begin();
-	ConstChannelIterator chan_u2 = other_user.channels().begin();
-
-	for (; chan_u1 != channels().end(); ++chan_u1) {
-		for (; chan_u2 < other_user.channels().end(); ++chan_u2) {
-			if (get_channel_reference(chan_u1).name() == get_channel_reference(chan_u2).name()) {
-				CORE_DEBUG("common channel found %s", (*chan_u1)->name().c_str());
-				return true;
-			}
-		}
+	for (ConstChannelIterator channel_it = channels().begin(); channel_it != channels().end(); ++channel_it) {
+		if (get_channel_reference(channel_it).has_user(other_user))
+			return true;
 	}
 	return false;
 }
@@ -341,74 +340,14 @@ std::string User::get_user_flags() const
 	return flags;
 }
 
-// TODO: fix masks
-bool User::has_mask(std::vector<Mask> masks) const
+void User::mark_users_sharing_a_channel() const
 {
-	std::vector<Mask>::iterator it = masks.begin();
-	size_t pos = 0;
-	for (; it != masks.end();)
-	{
-		pos = nickname().find(it->str, pos);
-		if (pos == std::string::npos)
-			break;
-		if (!it->before && pos != 0)
-			break ;
-		pos += it->str.size();
-		if (!it->after && pos < nickname().size())
-			break ;
-		++it;
-		if (it == masks.end())
-			return true;
+	m_current_sharing_mark++;
+	for (ConstChannelIterator channel_it = channels().begin(); channel_it != channels().end(); ++channel_it) {
+		const Channel& channel = get_channel_reference(channel_it);
+		for (Channel::ConstUserIterator user_it = channel.users().begin(); user_it != channel.users().end(); ++user_it)
+			user_it.user().m_sharing_mark = m_current_sharing_mark;
 	}
-
-	it = masks.begin();
-	pos = 0;
-	for (size_t i = 0; i < masks.size(); ++i) {
-		pos = username().find(it->str, pos);
-		if (pos == std::string::npos)
-			break;
-		if (!it->before && pos != 0)
-			break ;
-		pos += it->str.size();
-		if (!it->after && pos < username().size())
-			break ;
-		i++;
-		if (i == masks.size())
-			return true;
-	}
-
-	it = masks.begin();
-	pos = 0;
-	for (size_t i = 0; i < masks.size(); ++i) {
-		pos = hostname().find(it->str, pos);
-		if (pos == std::string::npos)
-			break;
-		if (!it->before && pos != 0)
-			break ;
-		pos += it->str.size();
-		if (!it->after && pos < hostname().size())
-			break ;
-		i++;
-		if (i == masks.size())
-			return true;
-	}
-
-	it = masks.begin();
-	pos = 0;
-	for (size_t i = 0; i < masks.size(); ++i) {
-		pos = realname().find(it->str, pos);
-		if (pos == std::string::npos)
-			break;
-		if (!it->before && pos != 0)
-			break ;
-		pos += it->str.size();
-		if (!it->after && pos < realname().size())
-			break ;
-		i++;
-		if (i == masks.size())
-			return true;
-	}
-	return false;
 }
 
 bool User::is_visible_to_user(User &user) const
@@ -425,7 +364,7 @@ void User::reply_list_of_channel_to_user(User &user)
 	std::string str;
 	ChannelIterator it = channels().begin();
 	for(size_t i = 0; it != channels().end(); ++it, ++i) {
-		Channel channel = get_channel_reference(it);
+		const Channel& channel = get_channel_reference(it);
 		str += channel.get_user_prefix(*this);
 		str += channel.name();
 		if (i == 10) {
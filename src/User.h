@@ -8,18 +8,20 @@
 #include <vector>
 #include <string>
 #include <netinet/in.h>
-#include <sys/poll.h>
 #include <unistd.h>
 #include <ctime>
 #include "log.h"
 #include "Utils.h"
 #include "Mode.h"
 #include "UserQueries.h"
+#include "InputBuffer.h"
+#include "OutputQueue.h"
 
 #define MAX_MESSAGE_LENGTH 512
+#define INPUT_BUFFER_INITIAL_SIZE MAX_MESSAGE_LENGTH
+#define INPUT_BUFFER_SIZE (MAX_MESSAGE_LENGTH * 16)
 
 class Channel;
-struct Mask;
 
 class User
 {
@@ -40,9 +42,9 @@ public:
 
 	bool		receive_message();
 	bool		send_message();
-	std::string	get_next_command_str();
+	bool		peek_next_command(StringView& command_line);
+	void		pop_next_command();
 	bool		has_pending_command();
-	std::string	source() const;
 
 	void		try_finish_registration();
 	bool		check_password();
@@ -52,6 +54,11 @@ public:
 
 	bool		has_channel_in_common(const User& other_user) const;
 	bool		is_visible_to_user(User& user) const;
+	/// Marks the users sharing a channel with this one, so that scans over
+	///  all the users can check is_visible_to_marking_user() in O(1).
+	///  The marks are only valid until the next call, from any user.
+	void		mark_users_sharing_a_channel() const;
+	bool		is_visible_to_marking_user() const { return !is_invisible() || m_sharing_mark == m_current_sharing_mark; }
 	void		reply_list_of_channel_to_user(User& user);
 
 	/// Mode
@@ -66,26 +73,31 @@ public:
 	/// getters
 	std::string				ping_token()		const	{ return m_ip + to_string(m_port) + m_realname; }
 	const std::string&		nickname()			const	{ return m_nickname; }
-	const std::string&		nickname_upper()	const	{ return m_nickname_upper; }
+	/// nick!~user@ip, kept up to date for the message prefixes and the channel masks
+	const std::string&		source()			const	{ return m_source; }
 	const std::string&		username()			const	{ return m_username; }
 	const std::string&		realname()			const	{ return m_realname; }
 	const std::string&		hostname()			const	{ return m_hostname; }
 	const std::string&		password()			const	{ return m_password; }
 	const std::string&		server()			const	{ return m_server_name; }
 	const int&				fd()				const	{ return m_fd; }
+	/// Unlike the fd, never reused by another connection
+	uint32_t				connection_id()		const	{ return m_connection_id; }
 	const std::string&		ip()				const	{ return m_ip; }
 	uint16_t				port()				const	{ return m_port; }
 	bool					is_disconnected()	const	{ return m_is_disconnected; }
-	bool					is_writable()		const	{ return m_is_writable; }
-	bool					is_readable()		const	{ return m_is_readable; }
+	bool					is_queued_for_flush()	const	{ return m_is_queued_for_flush; }
+	bool					is_queued_for_commands()	const	{ return m_is_queued_for_commands; }
+	bool					wants_write_events()	const	{ return m_wants_write_events; }
 	bool					is_registered()		const	{ return m_is_registered; }
 	bool					need_password()		const	{ return m_need_password; }
+	bool					has_multi_prefix()	const	{ return m_has_multi_prefix; }
 
 	      ChannelVector&	channels()					{ return m_channels; }
 	const ChannelVector&	channels()			const	{ return m_channels; }
 
-	const std::string&		read_buffer()				const	{ return m_readbuf; }
-	const std::string&		write_buffer()				const	{ return m_writebuf; }
+	const InputBuffer&		read_buffer()				const	{ return m_readbuf; }
+	const OutputQueue&		write_buffer()				const	{ return m_writebuf; }
 	std::size_t				data_sent_size()			const	{ return m_data_sent_size; }
 	std::size_t				data_received_size()		const	{ return m_data_received_size; }
 	std::size_t				sent_messages_count()		const	{ return m_sent_messages_count; }
@@ -105,20 +117,22 @@ public:
 
 	std::string				get_modes_as_str()	const;
 	std::string 			get_user_flags()	const;
-	bool					has_mask(std::vector<Mask> masks) const;
 
 	/// setters
-	void	set_nickname(const std::string& nickname)	{ m_nickname = nickname; m_nickname_upper = to_upper(nickname); }
-	void	set_username(const std::string& username)	{ m_username = username; }
+	void	set_nickname(const std::string& nickname)	{ m_nickname = nickname; update_names(); }
+	void	set_username(const std::string& username)	{ m_username = username; update_names(); }
 	void	set_realname(const std::string& realname)	{ m_realname = realname; }
 	void	set_server_name(const std::string& name)	{ m_server_name = name; }
 	void	set_is_negociating_capabilities(bool value)	{ m_is_negociating_capabilities = value; }
+	void	set_has_multi_prefix(bool value)			{ m_has_multi_prefix = value; }
 
-	void	queue_command_for_sending(const std::string& str)	{ m_writebuf.append(str); m_sent_messages_count++; }
+	void	queue_command_for_sending(const SharedMessage& msg)	{ m_writebuf.push(msg); m_sent_messages_count++; }
+	void	clear_write_buffer()								{ m_writebuf.clear(); }
 
-	void	disconnect() 								{ m_is_disconnected = true; }
-	void	set_is_readable(bool is_readable)			{ m_is_readable = is_readable; }
-	void	set_is_writable(bool is_writable)			{ m_is_writable = is_writable; }
+	void	disconnect();
+	void	set_is_queued_for_flush(bool value)			{ m_is_queued_for_flush = value; }
+	void	set_is_queued_for_commands(bool value)		{ m_is_queued_for_commands = value; }
+	void	set_wants_write_events(bool value)			{ m_wants_write_events = value; }
 	void	set_password(const std::string& password)	{ m_password = password; }
 
 	void	set_away_msg(const std::string& message)	{ m_away_message = message; }
@@ -136,21 +150,23 @@ public:
 	}
 
 	/// Debug
-	const char *debug_name();
+	const char *debug_name()	const	{ return m_debug_name.c_str(); }
 
 private:
 	void		take_signon_timestamp();
+	void		update_names();
 
 	std::string	m_nickname;
-	std::string m_nickname_upper;
 	std::string	m_username;
 	std::string	m_realname;
 	std::string m_hostname;
 	std::string	m_password;
 	std::string	m_server_name;
+	std::string	m_source;
+	std::string	m_debug_name;
 
-	std::string	m_readbuf;
-	std::string	m_writebuf;
+	InputBuffer	m_readbuf;
+	OutputQueue	m_writebuf;
 	std::size_t	m_data_sent_size;
 	std::size_t	m_data_received_size;
 	std::size_t	m_sent_messages_count;
@@ -160,13 +176,20 @@ private:
 	uint16_t	m_port;
 
 	int			m_fd;
+	uint32_t	m_connection_id;
+	static uint32_t	m_next_connection_id;
 
 	bool		m_is_disconnected;
-	bool		m_is_readable;
-	bool		m_is_writable;
+	bool		m_is_queued_for_flush;
+	bool		m_is_queued_for_commands;
+	bool		m_wants_write_events;
 	bool		m_is_registered;
 	bool		m_is_negociating_capabilities;
 	bool 		m_need_password;
+	bool		m_has_multi_prefix;
+
+	unsigned long			m_sharing_mark;
+	static unsigned long	m_current_sharing_mark;
 
 	ChannelVector	m_channels;
 
@@ -7,33 +7,16 @@
 #include "Numerics.h"
 #include "log.h"
 #include "ParamSplitter.h"
+#include "Hostmask.h"
 
-std::vector<Mask> parse_masks(const std::string& mask)
+// A mask with a '!' or a '@' is matched against the whole nick!~user@ip,
+//  any other one against each of the names of the user
+static bool is_matching_who_mask(const User& user, const Hostmask& mask, bool is_hostmask)
 {
-	std::vector<Mask> masks;
-	Mask sub_mask;
-
-	sub_mask.after = false;
-	sub_mask.before = false;
-
-	for (size_t i = 0; i < mask.size(); ++i) {
-		if (mask[i] != '*')
-			sub_mask.str += mask[i];
-		else if (mask[i] == '*' && sub_mask.str.empty())
-			sub_mask.before = true;
-		else {
-			sub_mask.after = true;
-			masks.push_back(sub_mask);
-			CORE_DEBUG("sub_mask: %s -> before: %d | after: %d", sub_mask.str.c_str(), sub_mask.before, sub_mask.after);
-			sub_mask.str.clear();
-			sub_mask.before = false;
-			sub_mask.after = false;
-		}
-	}
-	if (!sub_mask.str.empty())
-		masks.push_back(sub_mask);
-	CORE_DEBUG("masks size %d", masks.size());
-	return masks;
+	if (is_hostmask)
+		return mask.matches(StringView(user.source()));
+	return mask.matches(StringView(user.nickname())) || mask.matches(StringView(user.username()))
+		|| mask.matches(StringView(user.hostname())) || mask.matches(StringView(user.realname()));
 }
 
 int who(User& user, const Command& command)
@@ -72,20 +55,22 @@ int who(User& user, const Command& command)
 	}
 
 	// handle mask
-	if (mask.find('*') != std::string::npos)
+	if (Hostmask::has_wildcards(StringView(mask)))
 	{
 		CORE_DEBUG("mask: %s", mask.c_str());
 		if (mask.size() == 1)
 			return 1;
 
-		std::vector<Mask> masks = parse_masks(mask);
+		bool is_hostmask = mask.find_first_of("!@") != std::string::npos;
+		Hostmask compiled_mask(StringView(is_hostmask ? Hostmask::normalize(mask) : mask));
+		user.mark_users_sharing_a_channel();
 		Server::UserIterator user_it = Server::users().begin();
 		for (; user_it != Server::users().end(); ++user_it)
 		{
 			User& target_user = get_user_reference(user_it);
-			if (!target_user.has_mask(masks))
+			if (!is_matching_who_mask(target_user, compiled_mask, is_hostmask))
 				continue ;
-			if (target_user.is_visible_to_user(user)) {
+			if (target_user.is_visible_to_marking_user()) {
 				std::string flags = target_user.get_user_flags();
 				Server::reply(user, RPL_WHOREPLY(user, get_user_reference(user_it), "*", flags));
 			}
@@ -202,19 +187,16 @@ int whowas(User& user, const Command& command)
 		}
 	}
 
-	Server::OldUserIterator user_it = Server::find_old_user(nickname);
-	if (!Server::old_user_exists(user_it)) {
+	const OldUserInfo *old_user = Server::find_old_user(nickname);
+	if (!old_user) {
 		Server::reply(user, ERR_WASNOSUCHNICK(user, nickname));
 		Server::reply(user, RPL_ENDOFWHOWAS(user));
 		return 0;
 	}
 
-	for (std::size_t i = 0; i < max_entries; i++) {
-		if (Server::old_user_exists(user_it))
-			Server::reply(user, RPL_WHOWASUSER(user, *user_it));
-		else
-			break ;
-		user_it = Server::find_old_user(nickname, user_it);
+	for (std::size_t i = 0; i < max_entries && old_user; i++) {
+		Server::reply(user, RPL_WHOWASUSER(user, *old_user));
+		old_user = Server::find_previous_old_user(*old_user);
 	}
 	Server::reply(user, RPL_ENDOFWHOWAS(user));
 	return 0;
@@ -9,15 +9,6 @@
 #include <vector>
 #include "User.h"
 
-struct Mask
-{
-	std::string str;
-	bool before;
-	bool after;
-};
-
-std::vector<Mask> parse_masks(const std::string& mask);
-
 int who(User& user, const Command& command);
 int whois(User& user, const Command& command);
 int whowas(User& user, const Command& command);
@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <ctime>
 #include <cstring>
+#include <cstdio>
 #include "Utils.h"
 
 std::string to_upper(const std::string& str)
@@ -80,3 +81,25 @@ std::string format_date()
 
 	return buffer;
 }
+
+uint64_t monotonic_nanoseconds()
+{
+	timespec ts = {};
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+std::string format_duration(uint64_t nanoseconds)
+{
+	char buffer[32];
+	double value = static_cast<double>(nanoseconds);
+	if (nanoseconds < 1000)
+		std::snprintf(buffer, sizeof(buffer), "%uns", static_cast<unsigned int>(nanoseconds));
+	else if (nanoseconds < 1000000)
+		std::snprintf(buffer, sizeof(buffer), "%.1fus", value / 1e3);
+	else if (nanoseconds < 1000000000)
+		std::snprintf(buffer, sizeof(buffer), "%.2fms", value / 1e6);
+	else
+		std::snprintf(buffer, sizeof(buffer), "%.2fs", value / 1e9);
+	return buffer;
+}
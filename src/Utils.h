@@ -7,6 +7,7 @@
 
 #include <string>
 #include <sstream>
+#include <stdint.h>
 
 std::string	to_upper(const std::string& str);
 std::string to_lower(const std::string& str);
@@ -24,5 +25,9 @@ std::string to_string(T value)
 
 std::string get_current_date();
 std::string format_date();
+/// For measuring durations, unaffected by changes of the system time
+uint64_t	monotonic_nanoseconds();
+/// "850ns", "12.5us", "3.20ms", "1.05s"
+std::string	format_duration(uint64_t nanoseconds);
 
 #endif //UTILS_H
@@ -1,7 +1,12 @@
+#include <algorithm>
 #include <cstdarg>
-#include <iostream>
 #include <cstring>
 #include <cstdio>
+#include <cerrno>
+#include <strings.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
 #include "log.h"
 
 #define RESET   "\033[0m"
@@ -22,41 +27,283 @@
 #define BOLDCYAN    "\033[1m\033[36m"      /* Bold Cyan */
 #define BOLDWHITE   "\033[1m\033[37m"      /* Bold White */
 
+// A record holds a whole formatted message, longer ones are truncated
+#define LOG_RECORD_TEXT_SIZE 1016
+// Must be a power of 2
+#define LOG_RING_RECORDS 4096
+#define LOG_MAX_THREADS 16
+// How long the writer sleeps when every ring is empty, a ring getting half full wakes it up
+#define LOG_WRITER_IDLE_USEC 10000
+
 namespace Log
 {
 
-static void set_color(const char *error_level);
+struct Record
+{
+	Level	level;
+	int		length;
+	char	text[LOG_RECORD_TEXT_SIZE];
+};
 
-void log_message(bool newline, const char *error_level, const char *message, ...)
+// Single producer (the owning thread), single consumer (the writer thread).
+//  The counters only grow, their difference is the number of records queued.
+struct Ring
 {
-	__builtin_va_list args;
-	va_start(args, message);
-	if (error_level) {
-		set_color(error_level);
-		printf("%s: ", error_level);
+	Ring() : head(0), tail(0), dropped(0) {}
+
+	std::size_t	head;
+	std::size_t	tail;
+	std::size_t	dropped;
+	Record		records[LOG_RING_RECORDS];
+};
+
+static const char *level_names[] = { "DEBUG", "TRACE", "TRACE_IRC_ERR", "INFO", "WARN", "ERROR", "FATAL" };
+static const char *level_colors[] = { BLUE, WHITE, BOLDMAGENTA, GREEN, YELLOW, RED, BOLDRED };
+static const std::size_t level_count = sizeof(level_names) / sizeof(level_names[0]);
+
+Level					g_level = LEVEL_INFO;
+
+static Ring				*g_rings[LOG_MAX_THREADS];
+static std::size_t		g_ring_count = 0;
+static __thread Ring	*t_ring = NULL;
+
+static pthread_t		g_writer;
+static pthread_mutex_t	g_writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	g_writer_wakeup = PTHREAD_COND_INITIALIZER;
+static bool				g_is_writer_running = false;
+static bool				g_is_writer_stopping = false;
+static FILE				*g_output = NULL;
+static bool				g_is_output_colored = false;
+static std::size_t		g_reported_drops = 0;
+
+static void format_record(Record& record, Level level, const char *prefix, const char *message, va_list args);
+static void write_record(FILE *output, bool is_colored, const Record& record);
+static void push_record(Level level, const char *prefix, const char *message, va_list args);
+static Ring *thread_ring();
+static bool drain_rings();
+static void wait_for_records();
+static void *writer_routine(void *);
+
+bool set_level(const std::string& name)
+{
+	for (std::size_t i = 0; i < level_count; i++) {
+		if (strcasecmp(name.c_str(), level_names[i]) == 0) {
+			set_level(static_cast<Level>(i));
+			return true;
+		}
 	}
-	vprintf(message, args);
-	if (newline)
-		printf("%s\n", RESET);
+	return false;
+}
+
+void set_level(Level level)
+{
+	__atomic_store_n(&g_level, level, __ATOMIC_RELAXED);
+}
+
+const char *level_name(Level level)
+{
+	return level_names[level];
+}
+
+bool start(const std::string& path)
+{
+	if (g_is_writer_running)
+		return true;
+
+	g_output = stdout;
+	if (!path.empty()) {
+		g_output = std::fopen(path.c_str(), "a");
+		if (!g_output) {
+			g_output = stdout;
+			CORE_ERROR("Couldn't open the log file [%s]: %s", path.c_str(), strerror(errno));
+			return false;
+		}
+	}
+	g_is_output_colored = isatty(fileno(g_output));
+
+	g_is_writer_stopping = false;
+	if (pthread_create(&g_writer, NULL, writer_routine, NULL) != 0) {
+		CORE_ERROR("Couldn't start the log writer thread");
+		return false;
+	}
+	__atomic_store_n(&g_is_writer_running, true, __ATOMIC_RELEASE);
+	return true;
+}
+
+void stop()
+{
+	if (!g_is_writer_running)
+		return ;
+
+	__atomic_store_n(&g_is_writer_stopping, true, __ATOMIC_RELEASE);
+	pthread_join(g_writer, NULL);
+	__atomic_store_n(&g_is_writer_running, false, __ATOMIC_RELEASE);
+
+	if (g_output != stdout)
+		std::fclose(g_output);
+	g_output = NULL;
+}
+
+std::size_t dropped_count()
+{
+	std::size_t dropped = 0;
+	std::size_t ring_count = std::min<std::size_t>(__atomic_load_n(&g_ring_count, __ATOMIC_ACQUIRE), LOG_MAX_THREADS);
+	for (std::size_t i = 0; i < ring_count; i++) {
+		Ring *ring = __atomic_load_n(&g_rings[i], __ATOMIC_ACQUIRE);
+		if (ring)
+			dropped += __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+	}
+	return dropped;
+}
+
+void log_message(Level level, const char *message, ...)
+{
+	va_list args;
+	va_start(args, message);
+	push_record(level, NULL, message, args);
+	va_end(args);
+}
+
+void log_message_at(Level level, const char *file, int line, const char *function, const char *message, ...)
+{
+	char prefix[256];
+	std::snprintf(prefix, sizeof(prefix), "[%s:%d %s()]\t", file, line, function);
+
+	va_list args;
+	va_start(args, message);
+	push_record(level, prefix, message, args);
 	va_end(args);
 }
 
-static void set_color(const char *error_level)
-{
-	if (strcmp(error_level, "DEBUG") == 0)
-		printf("%s", BLUE);
-	else if (strcmp(error_level, "TRACE_IRC_ERR") == 0)
-		printf("%s", BOLDMAGENTA);
-	else if (strcmp(error_level, "TRACE") == 0)
-		printf("%s", WHITE);
-	else if (strcmp(error_level, "INFO") == 0)
-		printf("%s", GREEN);
-	else if (strcmp(error_level, "WARN") == 0)
-		printf("%s", YELLOW);
-	else if (strcmp(error_level, "ERROR") == 0)
-		printf("%s", RED);
-	else if (strcmp(error_level, "FATAL") == 0)
-		printf("%s", BOLDRED);
+static void push_record(Level level, const char *prefix, const char *message, va_list args)
+{
+	Ring *ring = __atomic_load_n(&g_is_writer_running, __ATOMIC_ACQUIRE) ? thread_ring() : NULL;
+	if (!ring) {
+		Record record;
+		format_record(record, level, prefix, message, args);
+		write_record(stdout, isatty(STDOUT_FILENO), record);
+		return ;
+	}
+
+	std::size_t tail = ring->tail;
+	std::size_t queued = tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	if (queued == LOG_RING_RECORDS) {
+		__atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+		return ;
+	}
+
+	// Formatted in place, the writer only sees the record once the tail moves past it
+	format_record(ring->records[tail & (LOG_RING_RECORDS - 1)], level, prefix, message, args);
+	__atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+
+	// Only a burst takes the lock, to wake the writer before the ring is full
+	if (queued + 1 == LOG_RING_RECORDS / 2) {
+		pthread_mutex_lock(&g_writer_mutex);
+		pthread_cond_signal(&g_writer_wakeup);
+		pthread_mutex_unlock(&g_writer_mutex);
+	}
+}
+
+static void format_record(Record& record, Level level, const char *prefix, const char *message, va_list args)
+{
+	record.level = level;
+	int length = 0;
+	if (prefix)
+		length = std::snprintf(record.text, LOG_RECORD_TEXT_SIZE, "%s", prefix);
+	if (length < LOG_RECORD_TEXT_SIZE)
+		length += std::vsnprintf(record.text + length, static_cast<std::size_t>(LOG_RECORD_TEXT_SIZE - length), message, args);
+	if (length >= LOG_RECORD_TEXT_SIZE) {
+		length = LOG_RECORD_TEXT_SIZE - 1;
+		std::memcpy(record.text + length - 3, "...", 3);
+	}
+	record.length = length < 0 ? 0 : length;
+}
+
+static void write_record(FILE *output, bool is_colored, const Record& record)
+{
+	if (is_colored)
+		std::fputs(level_colors[record.level], output);
+	std::fputs(level_names[record.level], output);
+	std::fputs(": ", output);
+	std::fwrite(record.text, 1, static_cast<std::size_t>(record.length), output);
+	if (is_colored)
+		std::fputs(RESET, output);
+	std::fputc('\n', output);
+}
+
+static Ring *thread_ring()
+{
+	if (t_ring)
+		return t_ring;
+
+	std::size_t index = __atomic_fetch_add(&g_ring_count, 1, __ATOMIC_ACQ_REL);
+	if (index >= LOG_MAX_THREADS)
+		return NULL;
+
+	// Published once constructed, the rings live until the process exits
+	t_ring = new Ring();
+	__atomic_store_n(&g_rings[index], t_ring, __ATOMIC_RELEASE);
+	return t_ring;
+}
+
+static bool drain_rings()
+{
+	bool has_drained = false;
+	std::size_t ring_count = std::min<std::size_t>(__atomic_load_n(&g_ring_count, __ATOMIC_ACQUIRE), LOG_MAX_THREADS);
+	for (std::size_t i = 0; i < ring_count; i++) {
+		Ring *ring = __atomic_load_n(&g_rings[i], __ATOMIC_ACQUIRE);
+		if (!ring)
+			continue ;
+
+		std::size_t head = ring->head;
+		std::size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+		for (; head != tail; head++)
+			write_record(g_output, g_is_output_colored, ring->records[head & (LOG_RING_RECORDS - 1)]);
+		if (ring->head != tail) {
+			__atomic_store_n(&ring->head, tail, __ATOMIC_RELEASE);
+			has_drained = true;
+		}
+	}
+
+	std::size_t dropped = dropped_count();
+	if (dropped != g_reported_drops) {
+		Record record;
+		record.level = LEVEL_WARN;
+		record.length = std::snprintf(record.text, LOG_RECORD_TEXT_SIZE, "%llu log messages were dropped, %llu since the start",
+			static_cast<unsigned long long>(dropped - g_reported_drops), static_cast<unsigned long long>(dropped));
+		write_record(g_output, g_is_output_colored, record);
+		g_reported_drops = dropped;
+	}
+	return has_drained;
+}
+
+static void wait_for_records()
+{
+	timeval now;
+	gettimeofday(&now, NULL);
+	long microseconds = now.tv_usec + LOG_WRITER_IDLE_USEC;
+	timespec deadline;
+	deadline.tv_sec = now.tv_sec + microseconds / 1000000;
+	deadline.tv_nsec = (microseconds % 1000000) * 1000;
+
+	pthread_mutex_lock(&g_writer_mutex);
+	pthread_cond_timedwait(&g_writer_wakeup, &g_writer_mutex, &deadline);
+	pthread_mutex_unlock(&g_writer_mutex);
+}
+
+static void *writer_routine(void *)
+{
+	while (!__atomic_load_n(&g_is_writer_stopping, __ATOMIC_ACQUIRE)) {
+		if (!drain_rings()) {
+			std::fflush(g_output);
+			wait_for_records();
+		}
+	}
+
+	// The producers are done, what they queued last is still written
+	drain_rings();
+	std::fflush(g_output);
+	return NULL;
 }
 
 }
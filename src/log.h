@@ -1,65 +1,84 @@
 #ifndef LOG_H
 # define LOG_H
 
-#define LOG_WARN_ENABLED 1
-#define LOG_INFO_ENABLED 1
-#define LOG_TRACE_ENABLED 1
-#define LOG_TRACE_IRC_ERR 1
+#include <string>
+#include <cstddef>
 
-#ifdef DEBUG
-# define LOG_DEBUG_ENABLED 1
-#else
-# define LOG_DEBUG_ENABLED 0
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_TRACE 1
+#define LOG_LEVEL_TRACE_IRC_ERR 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_WARN 4
+#define LOG_LEVEL_ERROR 5
+#define LOG_LEVEL_FATAL 6
+
+// Messages under this level are compiled out, the Makefile sets it for each build mode
+#ifndef LOG_COMPILE_LEVEL
+# define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
 #endif
 
+// Once start() is called, messages are formatted into a ring buffer of the
+//  calling thread, and a background thread writes them out. The rings are
+//  bounded: when one is full the message is dropped and counted, logging never
+//  blocks. Before start() and after stop(), messages are written synchronously.
 namespace Log
 {
-void log_message(bool newline, const char *error_level, const char *message, ...);
-}
 
+enum Level
+{
+	LEVEL_DEBUG = LOG_LEVEL_DEBUG,
+	LEVEL_TRACE = LOG_LEVEL_TRACE,
+	LEVEL_TRACE_IRC_ERR = LOG_LEVEL_TRACE_IRC_ERR,
+	LEVEL_INFO = LOG_LEVEL_INFO,
+	LEVEL_WARN = LOG_LEVEL_WARN,
+	LEVEL_ERROR = LOG_LEVEL_ERROR,
+	LEVEL_FATAL = LOG_LEVEL_FATAL
+};
 
-#if LOG_TRACE_ENABLED == 1
-# define CORE_TRACE(message, ...) {Log::log_message(true, "TRACE", message, ##__VA_ARGS__);}
-#else
-# define CORE_TRACE(message, ...)
-#endif
+/// Only read through level(), use set_level() to change it
+extern Level	g_level;
 
-#if LOG_DEBUG_ENABLED == 1
-# define CORE_DEBUG(message, ...) {Log::log_message(true, "DEBUG", message, ##__VA_ARGS__);}
-#else
-# define CORE_DEBUG(message, ...)
-#endif
+/// Messages under the level are discarded, from its name ("trace", "info"...)
+bool		set_level(const std::string& name);
+void		set_level(Level level);
+inline Level	level()						{ return __atomic_load_n(&g_level, __ATOMIC_RELAXED); }
+/// The first test is a constant, so the compiler drops the messages under LOG_COMPILE_LEVEL
+inline bool		is_enabled(Level level)		{ return static_cast<int>(level) >= LOG_COMPILE_LEVEL && level >= Log::level(); }
+const char	*level_name(Level level);
 
-#if LOG_TRACE_IRC_ERR == 1
-# define CORE_TRACE_IRC_ERR(message, ...) {Log::log_message(true, "TRACE_IRC_ERR", message, ##__VA_ARGS__);}
-#else
-# define CORE_TRACE_IRC_ERR(message, ...)
-#endif
+/// Starts the writer thread, writing to the file at path or to stdout if it is empty
+bool		start(const std::string& path);
+/// Writes the messages left and joins the writer thread
+void		stop();
+/// Messages lost because a ring buffer was full
+std::size_t	dropped_count();
 
-#if LOG_INFO_ENABLED == 1
-# define CORE_INFO(message, ...) {Log::log_message(true, "INFO", message, ##__VA_ARGS__);}
-#else
-# define CORE_INFO(message, ...)
-#endif
+/// Checked like printf() by the compiler
+void log_message(Level level, const char *message, ...) __attribute__((format(printf, 2, 3)));
+/// Prefixes the message with its location in the source
+void log_message_at(Level level, const char *file, int line, const char *function, const char *message, ...) __attribute__((format(printf, 5, 6)));
 
-#if LOG_WARN_ENABLED == 1
-# ifdef DEBUG
-#  define CORE_WARN(message, ...) {Log::log_message(false, "WARN", "[%s:%d %s()]\t", __FILE__, __LINE__, __func__); Log::log_message(true, NULL, message, ##__VA_ARGS__);}
-# else
-#  define CORE_WARN(message, ...) {Log::log_message(true, "WARN", message, ##__VA_ARGS__);}
-# endif
-#else
-# define CORE_WARN(message, ...)
-#endif
+}
+
+
+// Checks the level before the arguments are evaluated, a disabled message costs a compare
+#define LOG_MESSAGE(level, message, ...) do { if (Log::is_enabled(level)) Log::log_message(level, message, ##__VA_ARGS__); } while (0)
+#define LOG_MESSAGE_AT(level, message, ...) do { if (Log::is_enabled(level)) Log::log_message_at(level, __FILE__, __LINE__, __func__, message, ##__VA_ARGS__); } while (0)
+
+#define CORE_DEBUG(message, ...)			LOG_MESSAGE(Log::LEVEL_DEBUG, message, ##__VA_ARGS__)
+#define CORE_TRACE(message, ...)			LOG_MESSAGE(Log::LEVEL_TRACE, message, ##__VA_ARGS__)
+#define CORE_TRACE_IRC_ERR(message, ...)	LOG_MESSAGE(Log::LEVEL_TRACE_IRC_ERR, message, ##__VA_ARGS__)
+#define CORE_INFO(message, ...)				LOG_MESSAGE(Log::LEVEL_INFO, message, ##__VA_ARGS__)
+#define CORE_FATAL(message, ...)			LOG_MESSAGE(Log::LEVEL_FATAL, message, ##__VA_ARGS__)
 
 #ifdef DEBUG
-# define CORE_ERROR(message, ...) {Log::log_message(false, "ERROR", "[%s:%d %s()]\t", __FILE__, __LINE__, __func__); Log::log_message(true, NULL, message, ##__VA_ARGS__);}
+# define CORE_WARN(message, ...)			LOG_MESSAGE_AT(Log::LEVEL_WARN, message, ##__VA_ARGS__)
+# define CORE_ERROR(message, ...)			LOG_MESSAGE_AT(Log::LEVEL_ERROR, message, ##__VA_ARGS__)
 #else
-# define CORE_ERROR(message, ...) {Log::log_message(true, "ERROR", message, ##__VA_ARGS__);}
+# define CORE_WARN(message, ...)			LOG_MESSAGE(Log::LEVEL_WARN, message, ##__VA_ARGS__)
+# define CORE_ERROR(message, ...)			LOG_MESSAGE(Log::LEVEL_ERROR, message, ##__VA_ARGS__)
 #endif
 
-# define CORE_FATAL(message, ...) {Log::log_message(true, "FATAL", message, ##__VA_ARGS__);}
-
 #define TODO_PROPAGATE_ERRORS CORE_DEBUG("TODO: this function should propagate errors!");
 
 #endif
@@ -18,6 +18,8 @@ void initialize_signals()
 	sa.sa_flags = 0;
 	sigaction(SIGINT, &sa, NULL);
 	sigaction(SIGTERM, &sa, NULL);
+	// Logs the tick profile
+	sigaction(SIGUSR1, &sa, NULL);
 }
 
 int main(int argc, char* argv[])